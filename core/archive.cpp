@@ -0,0 +1,327 @@
+#include "archive.h"
+#include "be_field.h"
+#include <utility>
+#include <algorithm>
+#include "dol.h"
+
+// U8 header, all node and data offsets are absolute
+struct u8_header
+{
+  be_u32 magic;
+  be_u32 node_offset;
+  be_u32 meta_size;       // nodes and string table
+  be_u32 data_offset;
+  uint8_t reserved[16];
+};
+
+struct u8_node
+{
+  uint8_t type;           // 0 file, 1 directory
+  uint8_t name_offset[3];
+  be_u32 data_offset;     // file: data position, directory: parent node
+  be_u32 size;            // file: data size, directory: first node past its contents
+};
+
+// RARC header and info block, offsets are relative to the end of the header
+struct rarc_header
+{
+  be_u32 magic;
+  be_u32 file_size;
+  be_u32 header_size;
+  be_u32 data_offset;
+  be_u32 data_size;
+  be_u32 mram_size;
+  be_u32 aram_size;
+  be_u32 pad;
+
+  be_u32 num_dirs;
+  be_u32 dir_offset;
+  be_u32 num_entries;
+  be_u32 entry_offset;
+  be_u32 string_size;
+  be_u32 string_offset;
+  be_u16 num_files;
+  uint8_t sync;
+  uint8_t pad2[5];
+};
+
+struct rarc_dir
+{
+  be_u32 type;
+  be_u32 name_offset;
+  be_u16 name_hash;
+  be_u16 num_entries;
+  be_u32 first_entry;
+};
+
+struct rarc_entry
+{
+  be_u16 id;
+  be_u16 name_hash;
+  be_u32 type_name;       // type in the top byte, name offset below
+  be_u32 data_offset;     // file: relative to the data, directory: dir index
+  be_u32 data_size;
+  be_u32 pad;
+};
+
+// Disc header (boot.bin), followed by bi2.bin at 0x440
+struct gcm_header
+{
+  uint8_t game_code[4];
+  uint8_t maker_code[2];
+  uint8_t disc_id;
+  uint8_t version;
+  uint8_t audio_streaming;
+  uint8_t stream_buffer_size;
+  uint8_t unused[0x12];
+  be_u32 magic;             // GCM_MAGIC
+  uint8_t game_name[0x3E0];
+  be_u32 debug_monitor_offset;
+  be_u32 debug_monitor_address;
+  uint8_t unused2[0x18];
+  be_u32 dol_offset;
+  be_u32 fst_offset;
+  be_u32 fst_size;
+  be_u32 fst_max_size;
+  uint8_t unused3[0x10];
+};
+
+#define RARC_ENTRY_FILE   0x01
+#define RARC_ENTRY_DIR    0x02
+
+// Directory depth limit, protects against cycles in a corrupt RARC
+#define ARCHIVE_MAX_DEPTH 32
+
+static_assert(sizeof(u8_header) == 0x20, "u8_header must match the file layout");
+static_assert(sizeof(u8_node) == 0x0C, "u8_node must match the file layout");
+static_assert(sizeof(rarc_header) == 0x40, "rarc_header must match the file layout");
+static_assert(sizeof(rarc_dir) == 0x10, "rarc_dir must match the file layout");
+static_assert(sizeof(rarc_entry) == 0x14, "rarc_entry must match the file layout");
+static_assert(sizeof(gcm_header) == 0x440, "gcm_header must match the file layout");
+
+static bool read_block(input_source &input, uint64_t offset, uint64_t size, std::vector<uint8_t> &block)
+{
+  if ( size == 0 || offset > input.size() || size > input.size() - offset || size > 0x10000000 )
+    return false;
+  block.resize(static_cast<size_t>(size));
+  return input.read(offset, &block[0], block.size());
+}
+
+// Typed view into a file table, offsets are 64-bit so they can't wrap on the way in
+template<typename T>
+static T const *table_view(std::vector<uint8_t> const &block, uint64_t offset)
+{
+  if ( offset >= block.size() )
+    return nullptr;
+  return be_view<T>(&block[0], block.size(), static_cast<size_t>(offset));
+}
+
+// A NUL terminated name from a string table, false if it runs off the end
+static bool table_string(std::vector<uint8_t> const &block, uint64_t offset, std::string &name)
+{
+  if ( offset >= block.size() )
+    return false;
+  char const *start = reinterpret_cast<char const *>(&block[static_cast<size_t>(offset)]);
+  char const *end = static_cast<char const *>(memchr(start, 0, block.size() - static_cast<size_t>(offset)));
+  if ( end == nullptr )
+    return false;
+  name.assign(start, end);
+  return true;
+}
+
+// U8 archives and the disc FST share the same node table, with absolute data offsets
+static bool read_fst(input_source &input, uint64_t offset, uint64_t size, std::vector<archive_member> &members)
+{
+  // Nodes and names are read in one block
+  std::vector<uint8_t> meta;
+  if ( !read_block(input, offset, size, meta) )
+    return false;
+
+  u8_node const *root = table_view<u8_node>(meta, 0);
+  if ( root == nullptr || root->type != 1 )
+    return false;
+
+  uint32_t count = root->size;
+  if ( count == 0 || count > meta.size() / sizeof(u8_node) )
+    return false;
+  u8_node const *nodes = root;
+  uint64_t strings = static_cast<uint64_t>(count)*sizeof(u8_node);
+
+  // Directories end at a node index, keep the ones we are inside of
+  std::vector< std::pair<uint32_t, std::string> > dirs;
+  dirs.push_back(std::make_pair(count, std::string()));
+  for ( uint32_t i = 1; i < count; ++i )
+  {
+    while ( dirs.size() > 1 && i >= dirs.back().first )
+      dirs.pop_back();
+
+    u8_node const &node = nodes[i];
+    uint32_t name_offset = (node.name_offset[0] << 16) | (node.name_offset[1] << 8) | node.name_offset[2];
+    std::string name;
+    if ( !table_string(meta, strings + name_offset, name) )
+      return false;
+
+    std::string path = dirs.back().second + name;
+    if ( node.type == 1 )
+    {
+      if ( node.size <= i || node.size > dirs.back().first || dirs.size() >= ARCHIVE_MAX_DEPTH )
+        return false;
+      dirs.push_back(std::make_pair(node.size.get(), path + "/"));
+    }
+    else
+    {
+      archive_member member;
+      member.m_path = path;
+      member.m_offset = node.data_offset;
+      member.m_size = node.size;
+      if ( member.m_offset + member.m_size > input.size() )
+        return false;
+      members.push_back(member);
+    }
+  }
+  return true;
+}
+
+static bool read_u8(input_source &input, std::vector<archive_member> &members)
+{
+  u8_header header;
+  if ( !input.read(0, &header, sizeof(header)) )
+    return false;
+  return read_fst(input, header.node_offset, header.meta_size, members);
+}
+
+// Size of a DOL as the end of its furthest segment
+static uint64_t dol_size(dolhdr const &dhdr)
+{
+  uint64_t end = sizeof(dolhdr);
+  for ( int i = 0; i < 7; ++i )
+    end = std::max(end, static_cast<uint64_t>(dhdr.offsetText[i]) + dhdr.sizeText[i]);
+  for ( int i = 0; i < 11; ++i )
+    end = std::max(end, static_cast<uint64_t>(dhdr.offsetData[i]) + dhdr.sizeData[i]);
+  return end;
+}
+
+static bool read_gcm(input_source &input, std::vector<archive_member> &members)
+{
+  gcm_header header;
+  if ( !input.read(0, &header, sizeof(header)) )
+    return false;
+
+  // The boot DOL isn't part of the FST, it is listed under its usual extracted name
+  dolhdr dhdr;
+  if ( !input.read(header.dol_offset, &dhdr, sizeof(dhdr)) )
+    return false;
+
+  archive_member dol;
+  dol.m_path = GCM_DOL_PATH;
+  dol.m_offset = header.dol_offset;
+  dol.m_size = static_cast<uint32_t>(std::min<uint64_t>(dol_size(dhdr), input.size() - dol.m_offset));
+  members.push_back(dol);
+
+  return read_fst(input, header.fst_offset, header.fst_size, members);
+}
+
+static bool read_rarc_dir(input_source &input, std::vector<uint8_t> const &meta, rarc_header const &header, uint32_t dir_index,
+                          std::string const &prefix, unsigned depth, std::vector<archive_member> &members)
+{
+  if ( depth >= ARCHIVE_MAX_DEPTH || dir_index >= header.num_dirs )
+    return false;
+
+  // The file table starts right after the 0x20 byte header, which is where its offsets count from
+  rarc_dir const *dir = table_view<rarc_dir>(meta, header.dir_offset + static_cast<uint64_t>(dir_index)*sizeof(rarc_dir));
+  if ( dir == nullptr )
+    return false;
+
+  for ( uint32_t e = 0; e < dir->num_entries; ++e )
+  {
+    rarc_entry const *entry = table_view<rarc_entry>(meta, header.entry_offset + (static_cast<uint64_t>(dir->first_entry) + e)*sizeof(rarc_entry));
+    if ( entry == nullptr )
+      return false;
+
+    std::string name;
+    uint32_t type_name = entry->type_name;
+    if ( !table_string(meta, header.string_offset + static_cast<uint64_t>(type_name & 0x00FFFFFF), name) )
+      return false;
+
+    if ( (type_name >> 24) & RARC_ENTRY_DIR )
+    {
+      if ( name == "." || name == ".." )
+        continue;
+      if ( !read_rarc_dir(input, meta, header, entry->data_offset, prefix + name + "/", depth + 1, members) )
+        return false;
+    }
+    else if ( (type_name >> 24) & RARC_ENTRY_FILE )
+    {
+      archive_member member;
+      member.m_path = prefix + name;
+      member.m_offset = 0x20 + static_cast<uint64_t>(header.data_offset) + entry->data_offset;
+      member.m_size = entry->data_size;
+      if ( member.m_offset + member.m_size > input.size() )
+        return false;
+      members.push_back(member);
+    }
+  }
+  return true;
+}
+
+static bool read_rarc(input_source &input, std::vector<archive_member> &members)
+{
+  rarc_header header;
+  if ( !input.read(0, &header, sizeof(header)) )
+    return false;
+
+  // Everything between the header and the data is the file table
+  std::vector<uint8_t> meta;
+  if ( !read_block(input, 0x20, header.data_offset, meta) )
+    return false;
+
+  return read_rarc_dir(input, meta, header, 0, std::string(), 0, members);
+}
+
+// Archive magic at 0, or the disc magic at 0x1C
+static uint32_t archive_magic(input_source &input)
+{
+  be_u32 magic[8];
+  if ( input.size() < sizeof(magic) || !input.read(0, magic, sizeof(magic)) )
+    return 0;
+  if ( magic[7] == GCM_MAGIC && input.size() >= sizeof(gcm_header) )
+    return GCM_MAGIC;
+  return magic[0];
+}
+
+bool is_archive(input_source &input)
+{
+  uint32_t magic = archive_magic(input);
+  return magic == U8_MAGIC || magic == RARC_MAGIC || magic == GCM_MAGIC;
+}
+
+bool read_archive(input_source &input, std::vector<archive_member> &members)
+{
+  uint32_t magic = archive_magic(input);
+
+  members.clear();
+  if ( magic == U8_MAGIC )
+    return read_u8(input, members);
+  if ( magic == RARC_MAGIC )
+    return read_rarc(input, members);
+  if ( magic == GCM_MAGIC )
+    return read_gcm(input, members);
+  return false;
+}
+
+bool find_archive_member(input_source &input, std::string const &path, archive_member &member)
+{
+  std::vector<archive_member> members;
+  if ( !read_archive(input, members) )
+    return false;
+
+  for ( auto it = members.begin(); it != members.end(); ++it )
+  {
+    if ( it->m_path == path )
+    {
+      member = *it;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,68 @@
+#ifndef __ARCHIVE_H__
+#define __ARCHIVE_H__
+
+#include "input_source.h"
+#include <string>
+#include <vector>
+
+#define U8_MAGIC    0x55AA382D
+#define RARC_MAGIC  0x52415243   // 'RARC'
+#define GCM_MAGIC   0xC2339F3D   // GameCube disc, at 0x1C
+
+// Name the boot DOL of a disc image is listed under
+#define GCM_DOL_PATH "sys/main.dol"
+
+// A file stored in an archive
+struct archive_member
+{
+  std::string m_path;     // full path inside the archive, '/' separated
+  uint64_t m_offset;      // position of the data in the archive
+  uint32_t m_size;
+};
+
+// Recognizes U8 and RARC archives and GameCube disc images from their first bytes
+bool is_archive(input_source &input);
+
+// Reads the file table of a U8 or RARC archive or the FST of a disc image, listing every file it contains
+bool read_archive(input_source &input, std::vector<archive_member> &members);
+
+// Looks up a single file by its path in the archive
+bool find_archive_member(input_source &input, std::string const &path, archive_member &member);
+
+// A range of another source, such as an archive member, read in place
+class slice_source : public input_source
+{
+public:
+  slice_source(input_source &input, uint64_t offset, uint64_t size)
+    : m_input(input)
+    , m_offset(offset)
+    , m_size(size)
+  {}
+
+  uint64_t size() const
+  {
+    return m_size;
+  }
+
+  bool read(uint64_t offset, void *dst, size_t count)
+  {
+    if ( offset > m_size || count > m_size - offset )
+      return false;
+    return m_input.read(m_offset + offset, dst, count);
+  }
+
+  uint64_t file_offset(uint64_t offset) const
+  {
+    return m_input.file_offset(m_offset + offset);
+  }
+
+private:
+  slice_source(slice_source const &);
+  slice_source &operator =(slice_source const &);
+
+  input_source &m_input;
+  uint64_t m_offset;
+  uint64_t m_size;
+};
+
+#endif // #ifndef __ARCHIVE_H__
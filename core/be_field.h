@@ -0,0 +1,64 @@
+#ifndef __BE_FIELD_H__
+#define __BE_FIELD_H__
+
+#include <cstdint>
+#include <cstddef>
+
+// An integer stored in big endian byte order, decoded when it is read.
+// It is nothing but a byte array, so structs made of these have the exact on-disk
+// layout without padding and can be laid directly over file contents.
+template<typename T>
+class be_field
+{
+public:
+  T get() const
+  {
+    T value = 0;
+    for ( size_t i = 0; i < sizeof(T); ++i )
+      value = static_cast<T>((value << 8) | m_raw[i]);
+    return value;
+  }
+
+  operator T() const
+  {
+    return this->get();
+  }
+
+private:
+  uint8_t m_raw[sizeof(T)];
+};
+
+// Raw big endian loads and stores, for patching section contents in place
+inline uint32_t load_be32(uint8_t const *p)
+{
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8)  |  static_cast<uint32_t>(p[3]);
+}
+
+inline void store_be32(uint8_t *p, uint32_t value)
+{
+  p[0] = static_cast<uint8_t>(value >> 24);
+  p[1] = static_cast<uint8_t>(value >> 16);
+  p[2] = static_cast<uint8_t>(value >> 8);
+  p[3] = static_cast<uint8_t>(value);
+}
+
+inline void store_be16(uint8_t *p, uint16_t value)
+{
+  p[0] = static_cast<uint8_t>(value >> 8);
+  p[1] = static_cast<uint8_t>(value);
+}
+
+typedef be_field<uint16_t> be_u16;
+typedef be_field<uint32_t> be_u32;
+
+// Typed view of the bytes at data[offset], or nullptr if the struct doesn't fit
+template<typename T>
+T const *be_view(uint8_t const *data, size_t size, size_t offset = 0)
+{
+  if ( data == nullptr || offset > size || sizeof(T) > size - offset )
+    return nullptr;
+  return reinterpret_cast<T const *>(data + offset);
+}
+
+#endif // #ifndef __BE_FIELD_H__
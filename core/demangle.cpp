@@ -0,0 +1,483 @@
+#include "demangle.h"
+#include <cstring>
+#include <vector>
+
+// Bounds the recursion on nested types
+#define DEMANGLE_MAX_DEPTH 64
+
+// A type split around where the declarator goes, "void (*" and ")(int)" for a function pointer
+struct cw_type
+{
+  cw_type()
+    : m_parens(false)
+  {}
+
+  std::string m_left;
+  std::string m_right;
+  bool m_parens;        // function or array, a pointer to it needs parentheses
+};
+
+static std::string type_string(cw_type const &type)
+{
+  std::string s(type.m_left + type.m_right);
+  while ( !s.empty() && s[s.size() - 1] == ' ' )
+    s.resize(s.size() - 1);
+  return s;
+}
+
+struct cw_operator
+{
+  char const *m_code;
+  char const *m_name;
+};
+
+static cw_operator const cw_operators[] =
+{
+  { "nw", " new" },    { "dl", " delete" }, { "nwa", " new[]" }, { "dla", " delete[]" },
+  { "pl", "+" },       { "mi", "-" },       { "ml", "*" },       { "dv", "/" },
+  { "md", "%" },       { "er", "^" },       { "ad", "&" },       { "or", "|" },
+  { "co", "~" },       { "nt", "!" },       { "as", "=" },       { "lt", "<" },
+  { "gt", ">" },       { "apl", "+=" },     { "ami", "-=" },     { "amu", "*=" },
+  { "adv", "/=" },     { "amd", "%=" },     { "aer", "^=" },     { "aad", "&=" },
+  { "aor", "|=" },     { "ls", "<<" },      { "rs", ">>" },      { "ars", ">>=" },
+  { "als", "<<=" },    { "eq", "==" },      { "ne", "!=" },      { "le", "<=" },
+  { "ge", ">=" },      { "aa", "&&" },      { "oo", "||" },      { "pp", "++" },
+  { "mm", "--" },      { "cm", "," },       { "rm", "->*" },     { "rf", "->" },
+  { "cl", "()" },      { "vc", "[]" },
+  { nullptr, nullptr }
+};
+
+static std::string format_template(std::string const &name, int depth);
+
+class cw_parser
+{
+public:
+  cw_parser(char const *begin, char const *end, int depth)
+    : m_p(begin)
+    , m_end(end)
+    , m_depth(depth)
+  {}
+
+  bool at_end() const
+  {
+    return m_p == m_end;
+  }
+
+  char peek(size_t ahead = 0) const
+  {
+    return static_cast<size_t>(m_end - m_p) > ahead ? m_p[ahead] : '\0';
+  }
+
+  void skip()
+  {
+    ++m_p;
+  }
+
+  // 3Foo or Q23foo3Bar, last gets the innermost name without template arguments
+  bool qualified_name(std::string &out, std::string *last)
+  {
+    int parts = 1;
+    if ( this->peek() == 'Q' )
+    {
+      if ( this->peek(1) < '1' || this->peek(1) > '9' )
+        return false;
+      parts = this->peek(1) - '0';
+      m_p += 2;
+    }
+
+    out.clear();
+    for ( int i = 0; i < parts; ++i )
+    {
+      std::string part;
+      if ( !this->name_part(part) )
+        return false;
+      if ( i != 0 )
+        out += "::";
+      out += format_template(part, m_depth);
+      if ( last != nullptr )
+        *last = part.substr(0, part.find('<'));
+    }
+    return true;
+  }
+
+  bool type(cw_type &out)
+  {
+    if ( m_depth >= DEMANGLE_MAX_DEPTH )
+      return false;
+    ++m_depth;
+    bool ok = this->type_inner(out);
+    --m_depth;
+    return ok;
+  }
+
+  // Types up to the end or a '_', a lone v is an empty list
+  bool params(std::string &out)
+  {
+    out.clear();
+    if ( this->peek() == 'v' && (this->peek(1) == '\0' || this->peek(1) == '_') )
+    {
+      this->skip();
+      return true;
+    }
+
+    while ( !this->at_end() && this->peek() != '_' )
+    {
+      cw_type param;
+      if ( !this->type(param) )
+        return false;
+      if ( !out.empty() )
+        out += ", ";
+      out += type_string(param);
+    }
+    return true;
+  }
+
+private:
+  bool name_part(std::string &out)
+  {
+    size_t len = 0;
+    if ( this->peek() < '1' || this->peek() > '9' )
+      return false;
+    while ( this->peek() >= '0' && this->peek() <= '9' )
+    {
+      len = len * 10 + (this->peek() - '0');
+      if ( len > static_cast<size_t>(m_end - m_p) )
+        return false;
+      this->skip();
+    }
+    if ( len > static_cast<size_t>(m_end - m_p) )
+      return false;
+
+    out.assign(m_p, len);
+    m_p += len;
+    return true;
+  }
+
+  static char const *builtin(char code)
+  {
+    switch ( code )
+    {
+    case 'v': return "void";
+    case 'b': return "bool";
+    case 'c': return "char";
+    case 's': return "short";
+    case 'i': return "int";
+    case 'l': return "long";
+    case 'x': return "long long";
+    case 'f': return "float";
+    case 'd': return "double";
+    case 'r': return "long double";
+    case 'w': return "wchar_t";
+    case 'e': return "...";
+    }
+    return nullptr;
+  }
+
+  static void add_cv(cw_type &type, char const *cv)
+  {
+    if ( type.m_right.empty() && !type.m_left.empty() && type.m_left[type.m_left.size() - 1] != '*' &&
+         type.m_left[type.m_left.size() - 1] != '&' )
+      type.m_left = std::string(cv) + " " + type.m_left;
+    else
+      type.m_left += std::string(" ") + cv;
+  }
+
+  static void add_pointer(cw_type &type, char const *symbol)
+  {
+    if ( type.m_parens )
+    {
+      if ( !type.m_left.empty() && type.m_left[type.m_left.size() - 1] != ' ' && type.m_left[type.m_left.size() - 1] != '(' )
+        type.m_left += " ";
+      type.m_left += std::string("(") + symbol;
+      type.m_right = ")" + type.m_right;
+      type.m_parens = false;
+    }
+    else if ( !type.m_left.empty() && (type.m_left[type.m_left.size() - 1] == '*' || type.m_left[type.m_left.size() - 1] == '&') )
+      type.m_left += symbol;
+    else
+      type.m_left += std::string(" ") + symbol;
+  }
+
+  bool type_inner(cw_type &out)
+  {
+    char code = this->peek();
+    if ( code == '\0' )
+      return false;
+
+    switch ( code )
+    {
+    case 'C':
+    case 'V':
+      this->skip();
+      if ( !this->type(out) )
+        return false;
+      add_cv(out, code == 'C' ? "const" : "volatile");
+      return true;
+    case 'P':
+    case 'R':
+      this->skip();
+      if ( !this->type(out) )
+        return false;
+      add_pointer(out, code == 'P' ? "*" : "&");
+      return true;
+    case 'U':
+    case 'S':
+    {
+      char const *name = builtin(this->peek(1));
+      if ( name == nullptr || this->peek(1) == 'v' || this->peek(1) == 'e' )
+        return false;
+      m_p += 2;
+      out.m_left = std::string(code == 'U' ? "unsigned " : "signed ") + name;
+      return true;
+    }
+    case 'F':
+    {
+      // F params _ return
+      std::string args;
+      this->skip();
+      if ( !this->params(args) || this->peek() != '_' )
+        return false;
+      this->skip();
+
+      cw_type ret;
+      if ( !this->type(ret) )
+        return false;
+      out.m_left = ret.m_left + " ";
+      out.m_right = "(" + args + ")" + ret.m_right;
+      out.m_parens = true;
+      return true;
+    }
+    case 'A':
+    {
+      // A count _ element
+      std::string count;
+      this->skip();
+      while ( this->peek() >= '0' && this->peek() <= '9' )
+      {
+        count += this->peek();
+        this->skip();
+      }
+      if ( count.empty() || this->peek() != '_' )
+        return false;
+      this->skip();
+
+      if ( !this->type(out) )
+        return false;
+      out.m_right = "[" + count + "]" + out.m_right;
+      out.m_parens = true;
+      return true;
+    }
+    case 'M':
+    {
+      // M class member
+      std::string cls;
+      this->skip();
+      if ( !this->qualified_name(cls, nullptr) || !this->type(out) )
+        return false;
+      if ( out.m_parens )
+      {
+        out.m_left += "(" + cls + "::*";
+        out.m_right = ")" + out.m_right;
+        out.m_parens = false;
+      }
+      else
+        out.m_left += " " + cls + "::*";
+      return true;
+    }
+    case 'Q':
+      return this->qualified_name(out.m_left, nullptr);
+    }
+
+    if ( code >= '1' && code <= '9' )
+      return this->qualified_name(out.m_left, nullptr);
+
+    char const *name = builtin(code);
+    if ( name == nullptr )
+      return false;
+    this->skip();
+    out.m_left = name;
+    return true;
+  }
+
+  char const *m_p;
+  char const *m_end;
+  int m_depth;
+};
+
+// Foo<PCc,i> to Foo<const char *, int>, arguments that aren't types (constants) are kept
+static std::string format_template(std::string const &name, int depth)
+{
+  size_t open = name.find('<');
+  if ( open == std::string::npos || name[name.size() - 1] != '>' || depth >= DEMANGLE_MAX_DEPTH )
+    return name;
+
+  std::string out(name.substr(0, open + 1));
+  size_t start = open + 1, end = name.size() - 1;
+  int nesting = 0;
+  for ( size_t i = start; i <= end; ++i )
+  {
+    if ( i < end && name[i] == '<' )
+      ++nesting;
+    else if ( i < end && name[i] == '>' )
+      --nesting;
+    else if ( i == end || (name[i] == ',' && nesting == 0) )
+    {
+      char const *arg = name.c_str() + start;
+      cw_parser parser(arg, name.c_str() + i, depth + 1);
+      cw_type type;
+      if ( start != open + 1 )
+        out += ", ";
+      if ( parser.type(type) && parser.at_end() )
+        out += type_string(type);
+      else
+        out.append(arg, i - start);
+      start = i + 1;
+    }
+  }
+  if ( out[out.size() - 1] == '>' )
+    out += ' ';
+  return out + ">";
+}
+
+// Name of a special member function, empty if it is an ordinary name
+static bool special_name(std::string const &name, std::string const &cls_last, cw_parser *conversion, std::string &out)
+{
+  if ( name.size() < 3 || name[0] != '_' || name[1] != '_' )
+    return false;
+
+  std::string code(name.substr(2));
+  if ( code == "ct" )
+    out = cls_last;
+  else if ( code == "dt" )
+    out = "~" + cls_last;
+  else if ( code.compare(0, 2, "op") == 0 && conversion != nullptr )
+  {
+    // __opi is the conversion to int
+    cw_type type;
+    if ( !conversion->type(type) || !conversion->at_end() )
+      return false;
+    out = "operator " + type_string(type);
+  }
+  else
+  {
+    for ( cw_operator const *op = cw_operators; op->m_code != nullptr; ++op )
+    {
+      if ( code == op->m_code )
+      {
+        out = std::string("operator") + op->m_name;
+        return true;
+      }
+    }
+    return false;
+  }
+  return !out.empty();
+}
+
+// Demangles with the name ending at split, where the qualifiers start after "__"
+static bool demangle_at(char const *mangled, size_t split, std::string &out)
+{
+  std::string name(mangled, split);
+  char const *rest = mangled + split + 2;
+  cw_parser parser(rest, rest + strlen(rest), 0);
+
+  std::string cls, cls_last;
+  if ( parser.peek() == 'Q' || (parser.peek() >= '1' && parser.peek() <= '9') )
+  {
+    if ( !parser.qualified_name(cls, &cls_last) )
+      return false;
+  }
+
+  bool is_const = false;
+  if ( parser.peek() == 'C' && parser.peek(1) == 'F' )
+  {
+    is_const = true;
+    parser.skip();
+  }
+
+  bool is_function = parser.peek() == 'F';
+  std::string args, ret;
+  if ( is_function )
+  {
+    parser.skip();
+    if ( !parser.params(args) )
+      return false;
+
+    // Template functions add their return type
+    if ( parser.peek() == '_' )
+    {
+      cw_type type;
+      parser.skip();
+      if ( !parser.type(type) )
+        return false;
+      ret = type_string(type) + " ";
+    }
+  }
+  if ( !parser.at_end() || (!is_function && cls.empty()) )
+    return false;
+
+  std::string member;
+  if ( name.compare(0, 4, "__op") == 0 )
+  {
+    cw_parser conversion(name.c_str() + 4, name.c_str() + name.size(), 0);
+    if ( !special_name(name, cls_last, &conversion, member) )
+      return false;
+  }
+  else if ( !special_name(name, cls_last, nullptr, member) )
+  {
+    if ( name.compare(0, 2, "__") == 0 && name != "__" )
+      member = name;
+    else
+      member = format_template(name, 0);
+  }
+  if ( (name == "__ct" || name == "__dt") && cls.empty() )
+    return false;
+
+  out = ret;
+  if ( !cls.empty() )
+    out += cls + "::";
+  out += member;
+  if ( is_function )
+    out += "(" + args + ")" + (is_const ? " const" : "");
+  return true;
+}
+
+bool cw_demangle(char const *mangled, std::string &out)
+{
+  // Maps can list a symbol without a name, the search below starts past the first character
+  if ( mangled[0] == '\0' )
+    return false;
+
+  // The name ends at the first "__" that is followed by something that parses,
+  // names like __ct and __dt start with one themselves
+  for ( char const *p = strstr(mangled + 1, "__"); p != nullptr; p = strstr(p + 1, "__") )
+  {
+    if ( p[2] == '\0' )
+      break;
+    if ( demangle_at(mangled, p - mangled, out) )
+      return true;
+  }
+  return false;
+}
+
+char const *demangle_cache::demangle(char const *mangled)
+{
+  auto it = m_names.find(mangled);
+  if ( it == m_names.end() )
+  {
+    std::string demangled;
+    if ( !cw_demangle(mangled, demangled) )
+      demangled.clear();
+    it = m_names.insert(std::make_pair(std::string(mangled), demangled)).first;
+  }
+  return it->second.empty() ? nullptr : it->second.c_str();
+}
+
+size_t demangle_cache::size() const
+{
+  return m_names.size();
+}
+
+void demangle_cache::clear()
+{
+  m_names.clear();
+}
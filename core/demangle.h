@@ -0,0 +1,26 @@
+#ifndef __DEMANGLE_H__
+#define __DEMANGLE_H__
+
+#include <string>
+#include <unordered_map>
+
+// Demangles a CodeWarrior C++ name, e.g. __ct__Q23foo3BarFv to foo::Bar::Bar().
+// False if the name is not mangled or not understood.
+bool cw_demangle(char const *mangled, std::string &out);
+
+// Remembers every name it was asked about, mangled or not, since the same
+// symbols are imported by many modules. Owned by a load, so it goes away with it.
+class demangle_cache
+{
+public:
+  // Demangled name, nullptr if the name is not mangled. Valid as long as the cache.
+  char const *demangle(char const *mangled);
+
+  size_t size() const;
+  void clear();
+
+private:
+  std::unordered_map<std::string, std::string> m_names;   // empty for names that don't demangle
+};
+
+#endif // #ifndef __DEMANGLE_H__
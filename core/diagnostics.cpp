@@ -0,0 +1,72 @@
+#include "diagnostics.h"
+#include "rel.h"
+#include <cstdarg>
+#include <cstdio>
+
+static char const * const diag_names[DIAG_COUNT] =
+{
+  "relocations of unknown types were skipped",
+  "relocations outside of their section were skipped",
+  "imports refer to sections their module doesn't have",
+  "modules have id 0",
+  "modules have ids too large to resolve imports into",
+  "linker maps don't match their module's sections and were skipped"
+};
+
+load_diagnostics::load_diagnostics()
+{
+  this->clear();
+}
+
+void load_diagnostics::report(diag_category category, char const *format, ...)
+{
+  uint32_t n = m_counts[category]++;
+  if ( n >= DIAG_MAX_EXAMPLES )
+    return;
+
+  char *example = m_examples[category][n];
+  va_list va;
+  va_start(va, format);
+  int nbytes = vsnprintf(example, DIAG_EXAMPLE_SIZE, format, va);
+  va_end(va);
+  example[DIAG_EXAMPLE_SIZE - 1] = '\0';
+  if ( nbytes < 0 )
+    example[0] = '\0';
+}
+
+uint32_t load_diagnostics::count(diag_category category) const
+{
+  return m_counts[category];
+}
+
+bool load_diagnostics::empty() const
+{
+  for ( int i = 0; i < DIAG_COUNT; ++i )
+  {
+    if ( m_counts[i] != 0 )
+      return false;
+  }
+  return true;
+}
+
+void load_diagnostics::clear()
+{
+  for ( int i = 0; i < DIAG_COUNT; ++i )
+    m_counts[i] = 0;
+}
+
+void load_diagnostics::summarize(char const *prefix) const
+{
+  for ( int i = 0; i < DIAG_COUNT; ++i )
+  {
+    if ( m_counts[i] == 0 )
+      continue;
+
+    rel_msg("%s: %u %s\n", prefix, m_counts[i], diag_names[i]);
+    uint32_t examples = m_counts[i] < DIAG_MAX_EXAMPLES ? m_counts[i] : DIAG_MAX_EXAMPLES;
+    for ( uint32_t j = 0; j < examples; ++j )
+      rel_msg("    %s\n", m_examples[i][j]);
+    if ( m_counts[i] > examples )
+      rel_msg("    ...\n");
+  }
+}
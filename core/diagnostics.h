@@ -0,0 +1,43 @@
+#ifndef __DIAGNOSTICS_H__
+#define __DIAGNOSTICS_H__
+
+#include <cstdint>
+
+// Conditions that can happen once per relocation or module, too often to print each time
+enum diag_category
+{
+  DIAG_UNKNOWN_RELOCATION = 0,
+  DIAG_RELOCATION_OUT_OF_BOUNDS,
+  DIAG_INVALID_SECTION_REFERENCE,
+  DIAG_MODULE_ID_ZERO,
+  DIAG_MODULE_ID_TOO_LARGE,
+  DIAG_MAP_SECTION_MISMATCH,
+  DIAG_COUNT
+};
+
+#define DIAG_MAX_EXAMPLES 4
+#define DIAG_EXAMPLE_SIZE 96
+
+// Counts problems by category and keeps the text of the first few of each, for one summary at the end.
+// Callers only get here when something is wrong, nothing is allocated.
+class load_diagnostics
+{
+public:
+  load_diagnostics();
+
+  // Only the first DIAG_MAX_EXAMPLES of a category are formatted
+  void report(diag_category category, char const *format, ...);
+
+  uint32_t count(diag_category category) const;
+  bool empty() const;
+  void clear();
+
+  // Prints the counts and examples through rel_msg, prefixed with the loader name
+  void summarize(char const *prefix) const;
+
+private:
+  uint32_t m_counts[DIAG_COUNT];
+  char m_examples[DIAG_COUNT][DIAG_MAX_EXAMPLES][DIAG_EXAMPLE_SIZE];
+};
+
+#endif // #ifndef __DIAGNOSTICS_H__
@@ -22,16 +22,21 @@
     0100-....  Start of sections datas (body)
 */
 
+#include "be_field.h"
+
+/* all fields are big endian and decoded when they are accessed */
 typedef struct {
-  unsigned int offsetText[7];
-  unsigned int offsetData[11];
-  unsigned int addressText[7];
-  unsigned int addressData[11];
-  unsigned int sizeText[7];
-  unsigned int sizeData[11];
-  unsigned int addressBSS;
-  unsigned int sizeBSS;
-  unsigned int entrypoint;
+  be_u32 offsetText[7];
+  be_u32 offsetData[11];
+  be_u32 addressText[7];
+  be_u32 addressData[11];
+  be_u32 sizeText[7];
+  be_u32 sizeData[11];
+  be_u32 addressBSS;
+  be_u32 sizeBSS;
+  be_u32 entrypoint;
 } dolhdr;
 
+static_assert(sizeof(dolhdr) == 0xE4, "dolhdr must match the file layout");
+
 #endif
\ No newline at end of file
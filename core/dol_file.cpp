@@ -0,0 +1,150 @@
+/*
+ *  IDA Nintendo GameCube DOL Loader Module
+ *  (C) Copyright 2004 by Stefan Esser
+ *
+ */
+
+#include "dol_file.h"
+#include <cstdio>
+#include <vector>
+
+/*--------------------------------------------------------------------------
+ *
+ *   Read the header of the (possible) DOL file into memory. The fields stay
+ *   big endian and are converted when they are accessed.
+ *
+ */
+
+int read_dol_header(input_source &input, dolhdr *dhdr)
+{
+  // read in dolheader
+  if (!input.read(0, dhdr, sizeof(dolhdr))) return(0);
+  return(1);
+}
+
+/*--------------------------------------------------------------------------
+ *
+ *   Check if the header can belong to a DOL file of the given size.
+ *
+ */
+
+int check_dol_header(dolhdr const *dhdr, uint64_t filelen)
+{
+  int i, valid = 0;
+
+  // if to short for a DOL header then this is no DOL
+  if (filelen < 0x100) return(0);
+
+  // now perform some sanitychecks
+  for (i=0; i<7; i++) {
+    
+    // DOL segment MAY NOT physically stored in the header
+    if (dhdr->offsetText[i]!=0 && dhdr->offsetText[i]<0x100) return(0);
+    // end of physical storage must be within file
+    if (static_cast<uint64_t>(dhdr->offsetText[i])+dhdr->sizeText[i]>filelen) return(0);
+    // we only accept DOLs with segments above 2GB
+    if (dhdr->addressText[i] != 0 && !(dhdr->addressText[i] & 0x80000000)) return(0);
+
+    // remember that entrypoint was in a code segment
+    if (dhdr->entrypoint >= dhdr->addressText[i] && dhdr->entrypoint < dhdr->addressText[i]+dhdr->sizeText[i]) valid = 1;
+  }
+  for (i=0; i<11; i++) {
+
+    // DOL segment MAY NOT physically stored in the header
+    if (dhdr->offsetData[i]!=0 && dhdr->offsetData[i]<0x100) return(0);
+    // end of physical storage must be within file
+    if (static_cast<uint64_t>(dhdr->offsetData[i])+dhdr->sizeData[i]>filelen) return(0);
+    // we only accept DOLs with segments above 2GB
+    if (dhdr->addressData[i] != 0 && !(dhdr->addressData[i] & 0x80000000)) return(0);
+  }
+  
+  // if there is a BSS segment it must be above 2GB, too
+  if (dhdr->addressBSS != 0 && !(dhdr->addressBSS & 0x80000000)) return(0);
+  
+  // if entrypoint is not within a code segment reject this file
+  return(valid);
+}
+
+/*--------------------------------------------------------------------------
+ *
+ *   Create one segment and get the content from the file
+ *
+ */
+
+static int load_dol_segment(input_source &input, image_sink &sink, unsigned int offset, unsigned int address,
+                            unsigned int size, char const *name, char const *sclass)
+{
+  std::vector<uint8_t> data(size);
+
+  if (!sink.add_segment(address, address+size, name, sclass)) return(0);
+  if (size != 0 && input.read(offset, &data[0], size)) sink.load_bytes(address, &data[0], size, input.file_offset(offset));
+  return(1);
+}
+
+/*--------------------------------------------------------------------------
+ *
+ *   Create all segments of the DOL
+ *
+ */
+
+int load_dol(input_source &input, dolhdr const *dhdr, image_sink &sink)
+{
+  unsigned int snum;
+  int i;
+
+  // create all code segments
+  for (i=0, snum=1; i<7; i++, snum++) {
+    char buf[50];
+    
+    // 0 == no segment
+    if (dhdr->addressText[i] == 0) continue;
+    
+    // create a name according to segmenttype and number
+    sprintf(buf, NAME_CODE "%u", snum);
+    
+    // add the code segment
+    if (!load_dol_segment(input, sink, dhdr->offsetText[i], dhdr->addressText[i], dhdr->sizeText[i], buf, CLASS_CODE)) return(0);
+  }
+
+  // create all data segments
+  for (i=0, snum=1; i<11; i++, snum++) {
+    char buf[50];
+
+    // 0 == no segment
+    if (dhdr->addressData[i] == 0) continue;
+
+    // create a name according to segmenttype and number
+    sprintf(buf, NAME_DATA "%u", snum);
+
+    // add the data segment
+    if (!load_dol_segment(input, sink, dhdr->offsetData[i], dhdr->addressData[i], dhdr->sizeData[i], buf, CLASS_DATA)) return(0);
+  }
+
+  // is there a BSS defined?
+  if (dhdr->addressBSS != 0) {
+    // then add it
+    if (!sink.add_segment(dhdr->addressBSS, dhdr->addressBSS+dhdr->sizeBSS, NAME_BSS, CLASS_BSS)) return(0);
+  }
+  return(1);
+}
+
+/*--------------------------------------------------------------------------
+ *
+ *   Find where the DOL ends in memory, modules are placed behind it
+ *
+ */
+
+unsigned int dol_end_address(dolhdr const *dhdr)
+{
+  unsigned int end = 0;
+  int i;
+
+  for (i=0; i<7; i++) {
+    if (dhdr->addressText[i] != 0 && dhdr->addressText[i]+dhdr->sizeText[i] > end) end = dhdr->addressText[i]+dhdr->sizeText[i];
+  }
+  for (i=0; i<11; i++) {
+    if (dhdr->addressData[i] != 0 && dhdr->addressData[i]+dhdr->sizeData[i] > end) end = dhdr->addressData[i]+dhdr->sizeData[i];
+  }
+  if (dhdr->addressBSS != 0 && dhdr->addressBSS+dhdr->sizeBSS > end) end = dhdr->addressBSS+dhdr->sizeBSS;
+  return(end);
+}
@@ -0,0 +1,26 @@
+/*
+ *  IDA Nintendo GameCube DOL Loader Module
+ *  (C) Copyright 2004 by Stefan Esser
+ *
+ */
+
+#ifndef __DOL_FILE_H__
+#define __DOL_FILE_H__
+
+#include "dol.h"
+#include "input_source.h"
+#include "image_sink.h"
+
+// Reads the raw header, its fields decode themselves from big endian
+int read_dol_header(input_source &input, dolhdr *dhdr);
+
+// Sanity checks a header against the size of its file
+int check_dol_header(dolhdr const *dhdr, uint64_t filelen);
+
+// Creates all segments of the DOL and loads their contents
+int load_dol(input_source &input, dolhdr const *dhdr, image_sink &sink);
+
+// First address past every segment of the DOL, including the BSS
+unsigned int dol_end_address(dolhdr const *dhdr);
+
+#endif
@@ -0,0 +1,190 @@
+#include "game_link.h"
+#include "module_scan.h"
+#include "yaz0.h"
+#include "archive.h"
+#include "parallel.h"
+#include <algorithm>
+#include <utility>
+
+// Modules read from one file, before they are put in file name order
+struct linked_file
+{
+  std::vector<std::string> m_names;
+  std::vector< std::unique_ptr<rel_track> > m_tracks;
+  std::vector<std::string> m_errors;    // printed once the files are read, workers mustn't print
+};
+
+// Reads a whole module, the source can go away afterwards
+static void read_linked_module(input_source &input, std::string const &name, linked_file &file)
+{
+  module_probe probe;
+  if ( !probe_module(input, probe) )
+    return;
+
+  std::unique_ptr<rel_track> track(new rel_track(input, &probe, true));
+  if ( !track->is_good() || !track->load_all() )
+  {
+    std::vector<std::string> const &messages = track->held_messages();
+    file.m_errors.insert(file.m_errors.end(), messages.begin(), messages.end());
+    file.m_errors.push_back("REL: Unable to load " + name);
+    return;
+  }
+
+  file.m_names.push_back(module_stem(file_basename(name)));
+  file.m_tracks.push_back(std::move(track));
+}
+
+static void read_linked_file(std::string const &path, linked_file &file)
+{
+  // Plain stdio so this can run off the main thread, like the sibling scan
+  file_source raw(path.c_str());
+  if ( !raw.is_open() )
+    return;
+  yaz0_source input(raw);
+
+  if ( !is_archive(input) )
+  {
+    read_linked_module(input, path, file);
+    return;
+  }
+
+  std::vector<archive_member> members;
+  if ( !read_archive(input, members) )
+    return;
+
+  for ( auto it = members.begin(); it != members.end(); ++it )
+  {
+    if ( !is_module_source(it->m_path) )
+      continue;
+
+    slice_source slice(input, it->m_offset, it->m_size);
+    yaz0_source member(slice);
+    read_linked_module(member, it->m_path, file);
+  }
+}
+
+game_link::game_link()
+  : m_base(START)
+  , m_end(START)
+  , m_dol(false)
+{}
+
+void game_link::set_files(std::vector<std::string> const &files)
+{
+  m_files = files;
+  std::sort(m_files.begin(), m_files.end());
+}
+
+void game_link::set_base(uint32_t base)
+{
+  m_base = base;
+}
+
+void game_link::set_dol(bool loaded)
+{
+  m_dol = loaded;
+}
+
+size_t game_link::num_modules() const
+{
+  return m_tracks.size();
+}
+
+uint32_t game_link::end_address() const
+{
+  return m_end;
+}
+
+load_timings const &game_link::timings() const
+{
+  return m_timings;
+}
+
+void game_link::read_modules()
+{
+  m_tracks.clear();
+  m_names.clear();
+
+  // Files are read concurrently, each into its own slot so the order stays the file order
+  std::unique_ptr<linked_file[]> files(new linked_file[m_files.size()]);
+  parallel_for_index(m_files.size(), [&](size_t i)
+  {
+    read_linked_file(m_files[i], files[i]);
+  });
+
+  for ( size_t i = 0; i < m_files.size(); ++i )
+  {
+    for ( auto it = files[i].m_errors.begin(); it != files[i].m_errors.end(); ++it )
+      rel_msg("%s\n", it->c_str());
+    for ( size_t j = 0; j < files[i].m_tracks.size(); ++j )
+    {
+      m_names.push_back(files[i].m_names[j]);
+      m_tracks.push_back(std::move(files[i].m_tracks[j]));
+    }
+  }
+}
+
+bool game_link::link(image_sink &sink)
+{
+  m_layout.clear();
+  m_timings = load_timings();
+  m_demangler.clear();
+  this->read_modules();
+
+  // Modules follow each other from the base, a duplicate id resolves to the last one by file name
+  uint32_t next = m_base;
+  std::vector<uint32_t> addresses;
+  for ( size_t i = 0; i < m_tracks.size(); ++i )
+  {
+    rel_track &track = *m_tracks[i];
+    uint32_t end = track.place(next);
+
+    addresses.resize(track.num_sections());
+    for ( size_t s = 0; s < addresses.size(); ++s )
+      addresses[s] = track.section_address(static_cast<uint8_t>(s));
+    m_layout.add_module(track.id(), m_names[i].c_str(), addresses.empty() ? nullptr : &addresses[0], addresses.size());
+
+    next = (end + LINK_MODULE_ALIGN - 1) & ~(LINK_MODULE_ALIGN - 1);
+  }
+  if ( m_dol )
+    m_layout.add_dol();
+
+  // Linker maps are next to the module files
+  for ( auto it = m_files.begin(); it != m_files.end(); ++it )
+    m_layout.add_map_dir(it->substr(0, it->size() - file_basename(*it).size()));
+
+  // Every module is relocated against the finished layout on its own
+  std::vector<char> linked(m_tracks.size(), 0);
+  parallel_for_index(m_tracks.size(), [&](size_t i)
+  {
+    linked[i] = m_tracks[i]->link_relocations(m_layout);
+  });
+  for ( size_t i = 0; i < m_tracks.size(); ++i )
+    m_tracks[i]->print_messages();
+
+  // Imports from modules that aren't there still get XTRN slots, after all modules
+  for ( size_t i = 0; i < m_tracks.size(); ++i )
+  {
+    if ( linked[i] )
+      next = m_tracks[i]->place_imports(next);
+  }
+  m_end = next;
+
+  // The sink is only ever used from here
+  bool ok = true;
+  for ( size_t i = 0; i < m_tracks.size(); ++i )
+  {
+    rel_track &track = *m_tracks[i];
+    track.set_demangle_cache(&m_demangler);
+    bool written = linked[i] && track.write_linked(sink);
+    track.print_messages();
+    if ( !written )
+    {
+      rel_msg("REL: Failed to link %s\n", m_names[i].c_str());
+      ok = false;
+    }
+    track.diagnostics().summarize(m_names[i].c_str());
+    m_timings.add(track.timings());
+  }
+  return ok;
+}
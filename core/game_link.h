@@ -0,0 +1,59 @@
+#ifndef __GAME_LINK_H__
+#define __GAME_LINK_H__
+
+#include "rel_track.h"
+#include "module_layout.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Gap between linked modules, the runtime allocates modules with this alignment
+#define LINK_MODULE_ALIGN 0x20
+
+// Loads all modules of a game into one image next to its DOL. Each module gets its own base and
+// imports between them, and from the DOL, are patched to their real targets instead of XTRN slots.
+//
+// Modules are read and relocated concurrently, only creating them in the sink is serial.
+class game_link
+{
+public:
+  game_link();
+
+  // Files to load modules from: RELs, or archives and disc images holding them. Loaded in file name order.
+  void set_files(std::vector<std::string> const &files);
+
+  // Where the first module goes, usually the end of the DOL
+  void set_base(uint32_t base);
+
+  // Whether the DOL is in the same image, imports from it are only patched then
+  void set_dol(bool loaded);
+
+  bool link(image_sink &sink);
+
+  size_t num_modules() const;
+
+  // First address past everything that was created
+  uint32_t end_address() const;
+
+  // Summed over all modules
+  load_timings const &timings() const;
+
+private:
+  game_link(game_link const &);
+  game_link &operator =(game_link const &);
+
+  void read_modules();
+
+  std::vector<std::string> m_files;
+  uint32_t m_base;
+  uint32_t m_end;
+  bool m_dol;
+
+  std::vector< std::unique_ptr<rel_track> > m_tracks;
+  std::vector<std::string> m_names;     // by track
+  module_layout m_layout;
+  load_timings m_timings;
+  demangle_cache m_demangler;   // shared by all modules, names are written one module at a time
+};
+
+#endif // #ifndef __GAME_LINK_H__
@@ -0,0 +1,49 @@
+#ifndef __IMAGE_SINK_H__
+#define __IMAGE_SINK_H__
+
+#include <cstdint>
+#include <cstddef>
+
+#define CLASS_CODE    "CODE"
+#define NAME_CODE     ".text"
+
+#define CLASS_DATA    "DATA"
+#define NAME_DATA     ".data"
+
+#define CLASS_BSS     "BSS"
+#define NAME_BSS      ".bss"
+
+#define CLASS_EXTERN  "XTRN"
+#define NAME_EXTERN   ".ref"
+
+// Destination of a loaded image: the IDA database, a flat memory dump, ...
+class image_sink
+{
+public:
+  virtual ~image_sink() {}
+
+  // Creates a 32-bit segment [start, end)
+  virtual bool add_segment(uint32_t start, uint32_t end, char const *name, char const *sclass) = 0;
+
+  // Loads file contents as the original bytes at ea
+  virtual bool load_bytes(uint32_t ea, void const *data, size_t size, uint64_t file_offset) = 0;
+
+  // Overwrites loaded bytes, the loaded bytes remain the originals
+  virtual void patch_bytes(uint32_t ea, void const *data, size_t size) = 0;
+
+  // Fills bytes that have no file backing (e.g. import slots)
+  virtual void put_bytes(uint32_t ea, void const *data, size_t size) = 0;
+
+  virtual void set_name(uint32_t ea, char const *name) = 0;
+
+  // Adds a line in front of the item at ea
+  virtual void add_comment(uint32_t ea, char const *text) = 0;
+
+  // Adds a line to the description of the whole image
+  virtual void add_program_comment(char const *text) = 0;
+
+  // Marks an exported library function
+  virtual void add_export(uint32_t ea, char const *name) = 0;
+};
+
+#endif // #ifndef __IMAGE_SINK_H__
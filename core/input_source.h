@@ -0,0 +1,101 @@
+#ifndef __INPUT_SOURCE_H__
+#define __INPUT_SOURCE_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#define NO_FILE_OFFSET (~static_cast<uint64_t>(0))
+
+// Random access byte source that a module is parsed from
+class input_source
+{
+public:
+  virtual ~input_source() {}
+
+  virtual uint64_t size() const = 0;
+
+  // Reads exactly count bytes at offset, false on a short read
+  virtual bool read(uint64_t offset, void *dst, size_t count) = 0;
+
+  // Where offset is in the file that was opened, NO_FILE_OFFSET if the data doesn't come from it directly
+  virtual uint64_t file_offset(uint64_t offset) const
+  {
+    return offset;
+  }
+};
+
+// A file opened through stdio
+class file_source : public input_source
+{
+public:
+  file_source(char const *path)
+    : m_fp(fopen(path, "rb"))
+    , m_size(0)
+  {
+    if ( m_fp != nullptr && fseek(m_fp, 0, SEEK_END) == 0 )
+      m_size = static_cast<uint64_t>(ftell(m_fp));
+  }
+
+  ~file_source()
+  {
+    if ( m_fp != nullptr )
+      fclose(m_fp);
+  }
+
+  bool is_open() const
+  {
+    return m_fp != nullptr;
+  }
+
+  uint64_t size() const
+  {
+    return m_size;
+  }
+
+  bool read(uint64_t offset, void *dst, size_t count)
+  {
+    if ( m_fp == nullptr || offset > m_size || count > m_size - offset )
+      return false;
+    if ( fseek(m_fp, static_cast<long>(offset), SEEK_SET) != 0 )
+      return false;
+    return fread(dst, 1, count, m_fp) == count;
+  }
+
+private:
+  file_source(file_source const &);
+  file_source &operator =(file_source const &);
+
+  FILE *m_fp;
+  uint64_t m_size;
+};
+
+// A block of memory owned by someone else
+class memory_source : public input_source
+{
+public:
+  memory_source(uint8_t const *data, size_t size)
+    : m_data(data)
+    , m_size(size)
+  {}
+
+  uint64_t size() const
+  {
+    return m_size;
+  }
+
+  bool read(uint64_t offset, void *dst, size_t count)
+  {
+    if ( offset > m_size || count > m_size - offset )
+      return false;
+    memcpy(dst, m_data + offset, count);
+    return true;
+  }
+
+private:
+  uint8_t const *m_data;
+  size_t m_size;
+};
+
+#endif // #ifndef __INPUT_SOURCE_H__
@@ -0,0 +1,216 @@
+#include "load_stats.h"
+#include "rel.h"
+#include <cstdlib>
+
+static char const *relocation_name(unsigned type)
+{
+  switch ( type )
+  {
+  case R_PPC_NONE:            return "R_PPC_NONE";
+  case R_PPC_ADDR32:          return "R_PPC_ADDR32";
+  case R_PPC_ADDR24:          return "R_PPC_ADDR24";
+  case R_PPC_ADDR16:          return "R_PPC_ADDR16";
+  case R_PPC_ADDR16_LO:       return "R_PPC_ADDR16_LO";
+  case R_PPC_ADDR16_HI:       return "R_PPC_ADDR16_HI";
+  case R_PPC_ADDR16_HA:       return "R_PPC_ADDR16_HA";
+  case R_PPC_ADDR14:          return "R_PPC_ADDR14";
+  case R_PPC_ADDR14_BRTAKEN:  return "R_PPC_ADDR14_BRTAKEN";
+  case R_PPC_ADDR14_BRNTAKEN: return "R_PPC_ADDR14_BRNTAKEN";
+  case R_PPC_REL24:           return "R_PPC_REL24";
+  case R_PPC_REL14:           return "R_PPC_REL14";
+  case R_DOLPHIN_NOP:         return "R_DOLPHIN_NOP";
+  case R_DOLPHIN_SECTION:     return "R_DOLPHIN_SECTION";
+  case R_DOLPHIN_END:         return "R_DOLPHIN_END";
+  case R_DOLPHIN_MRKREF:      return "R_DOLPHIN_MRKREF";
+  }
+  return nullptr;
+}
+
+load_counters::load_counters()
+  : m_reads(0)
+  , m_read_bytes(0)
+  , m_sink_calls(0)
+{
+  for ( int i = 0; i < 256; ++i )
+    m_relocations[i] = 0;
+}
+
+bool load_stats_enabled()
+{
+  char const *value = getenv(LOAD_STATS_ENV);
+  return value != nullptr && value[0] != '\0' && strcmp(value, "0") != 0;
+}
+
+counting_source::counting_source(input_source &input, load_counters &counters)
+  : m_input(input)
+  , m_counters(counters)
+{}
+
+uint64_t counting_source::size() const
+{
+  return m_input.size();
+}
+
+bool counting_source::read(uint64_t offset, void *dst, size_t count)
+{
+  ++m_counters.m_reads;
+  m_counters.m_read_bytes += count;
+  return m_input.read(offset, dst, count);
+}
+
+uint64_t counting_source::file_offset(uint64_t offset) const
+{
+  return m_input.file_offset(offset);
+}
+
+counting_sink::counting_sink(image_sink &sink, load_counters &counters)
+  : m_sink(sink)
+  , m_counters(counters)
+{}
+
+bool counting_sink::add_segment(uint32_t start, uint32_t end, char const *name, char const *sclass)
+{
+  ++m_counters.m_sink_calls;
+  return m_sink.add_segment(start, end, name, sclass);
+}
+
+bool counting_sink::load_bytes(uint32_t ea, void const *data, size_t size, uint64_t file_offset)
+{
+  ++m_counters.m_sink_calls;
+  return m_sink.load_bytes(ea, data, size, file_offset);
+}
+
+void counting_sink::patch_bytes(uint32_t ea, void const *data, size_t size)
+{
+  ++m_counters.m_sink_calls;
+  m_sink.patch_bytes(ea, data, size);
+}
+
+void counting_sink::put_bytes(uint32_t ea, void const *data, size_t size)
+{
+  ++m_counters.m_sink_calls;
+  m_sink.put_bytes(ea, data, size);
+}
+
+void counting_sink::set_name(uint32_t ea, char const *name)
+{
+  ++m_counters.m_sink_calls;
+  m_sink.set_name(ea, name);
+}
+
+void counting_sink::add_comment(uint32_t ea, char const *text)
+{
+  ++m_counters.m_sink_calls;
+  m_sink.add_comment(ea, text);
+}
+
+void counting_sink::add_program_comment(char const *text)
+{
+  ++m_counters.m_sink_calls;
+  m_sink.add_program_comment(text);
+}
+
+void counting_sink::add_export(uint32_t ea, char const *name)
+{
+  ++m_counters.m_sink_calls;
+  m_sink.add_export(ea, name);
+}
+
+void print_load_stats(char const *name, load_timings const &timings, load_counters const &counters)
+{
+  rel_msg("Load statistics for %s\n", name);
+
+  uint64_t total = 0;
+  for ( int phase = 0; phase < PHASE_COUNT; ++phase )
+  {
+    total += timings.m_usec[phase];
+    rel_msg("  %-22s %10llu us\n", load_phase_name(static_cast<load_phase>(phase)),
+      static_cast<unsigned long long>(timings.m_usec[phase]));
+  }
+  rel_msg("  %-22s %10llu us\n", "total", static_cast<unsigned long long>(total));
+
+  for ( unsigned type = 0; type < 256; ++type )
+  {
+    if ( counters.m_relocations[type] == 0 )
+      continue;
+    char const *type_name = relocation_name(type);
+    if ( type_name != nullptr )
+      rel_msg("  %-22s %10llu\n", type_name, static_cast<unsigned long long>(counters.m_relocations[type]));
+    else
+      rel_msg("  type %-17u %10llu\n", type, static_cast<unsigned long long>(counters.m_relocations[type]));
+  }
+  for ( auto it = counters.m_module_relocations.begin(); it != counters.m_module_relocations.end(); ++it )
+    rel_msg("  module %-15u %10llu relocations\n", it->first, static_cast<unsigned long long>(it->second));
+
+  rel_msg("  %llu reads, %llu bytes, %llu database calls\n", static_cast<unsigned long long>(counters.m_reads),
+    static_cast<unsigned long long>(counters.m_read_bytes), static_cast<unsigned long long>(counters.m_sink_calls));
+}
+
+static void write_json_string(FILE *fp, char const *text)
+{
+  fputc('"', fp);
+  for ( ; *text != '\0'; ++text )
+  {
+    unsigned char c = static_cast<unsigned char>(*text);
+    if ( c == '"' || c == '\\' )
+      fprintf(fp, "\\%c", c);
+    else if ( c < 0x20 )
+      fprintf(fp, "\\u%04x", c);
+    else
+      fputc(c, fp);
+  }
+  fputc('"', fp);
+}
+
+void write_load_stats(FILE *fp, char const *name, load_timings const &timings, load_counters const &counters, int indent)
+{
+  fprintf(fp, "%*s{\n%*s  \"module\": ", indent, "", indent, "");
+  write_json_string(fp, name);
+
+  fprintf(fp, ",\n%*s  \"phases_usec\": {", indent, "");
+  for ( int phase = 0; phase < PHASE_COUNT; ++phase )
+  {
+    fprintf(fp, "%s\n%*s    \"%s\": %llu", phase == 0 ? "" : ",", indent, "", load_phase_name(static_cast<load_phase>(phase)),
+      static_cast<unsigned long long>(timings.m_usec[phase]));
+  }
+
+  fprintf(fp, "\n%*s  },\n%*s  \"relocations_by_type\": {", indent, "", indent, "");
+  bool first = true;
+  for ( unsigned type = 0; type < 256; ++type )
+  {
+    if ( counters.m_relocations[type] == 0 )
+      continue;
+    char const *type_name = relocation_name(type);
+    fprintf(fp, "%s\n%*s    ", first ? "" : ",", indent, "");
+    if ( type_name != nullptr )
+      fprintf(fp, "\"%s\"", type_name);
+    else
+      fprintf(fp, "\"%u\"", type);
+    fprintf(fp, ": %llu", static_cast<unsigned long long>(counters.m_relocations[type]));
+    first = false;
+  }
+
+  fprintf(fp, "\n%*s  },\n%*s  \"relocations_by_module\": {", indent, "", indent, "");
+  first = true;
+  for ( auto it = counters.m_module_relocations.begin(); it != counters.m_module_relocations.end(); ++it )
+  {
+    fprintf(fp, "%s\n%*s    \"%u\": %llu", first ? "" : ",", indent, "", it->first, static_cast<unsigned long long>(it->second));
+    first = false;
+  }
+
+  fprintf(fp, "\n%*s  },\n", indent, "");
+  fprintf(fp, "%*s  \"reads\": %llu,\n", indent, "", static_cast<unsigned long long>(counters.m_reads));
+  fprintf(fp, "%*s  \"bytes_read\": %llu,\n", indent, "", static_cast<unsigned long long>(counters.m_read_bytes));
+  fprintf(fp, "%*s  \"database_calls\": %llu\n", indent, "", static_cast<unsigned long long>(counters.m_sink_calls));
+  fprintf(fp, "%*s}", indent, "");
+}
+
+bool save_load_stats(char const *path, char const *name, load_timings const &timings, load_counters const &counters)
+{
+  FILE *fp = fopen(path, "w");
+  if ( fp == nullptr )
+    return false;
+  write_load_stats(fp, name, timings, counters);
+  fputc('\n', fp);
+  return fclose(fp) == 0;
+}
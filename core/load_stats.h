@@ -0,0 +1,77 @@
+#ifndef __LOAD_STATS_H__
+#define __LOAD_STATS_H__
+
+#include "input_source.h"
+#include "image_sink.h"
+#include "load_timer.h"
+#include <cstdio>
+#include <map>
+
+// Set to anything but 0 to get a report of every load
+#define LOAD_STATS_ENV "WII_LOADER_STATS"
+
+// What a load did, besides the time it took
+struct load_counters
+{
+  load_counters();
+
+  uint64_t m_relocations[256];                        // by relocation type
+  std::map<uint32_t, uint64_t> m_module_relocations;  // by target module id
+  uint64_t m_reads;
+  uint64_t m_read_bytes;
+  uint64_t m_sink_calls;
+};
+
+bool load_stats_enabled();
+
+// Passes reads through and counts them
+class counting_source : public input_source
+{
+public:
+  counting_source(input_source &input, load_counters &counters);
+
+  uint64_t size() const;
+  bool read(uint64_t offset, void *dst, size_t count);
+  uint64_t file_offset(uint64_t offset) const;
+
+private:
+  counting_source(counting_source const &);
+  counting_source &operator =(counting_source const &);
+
+  input_source &m_input;
+  load_counters &m_counters;
+};
+
+// Passes everything through and counts the calls
+class counting_sink : public image_sink
+{
+public:
+  counting_sink(image_sink &sink, load_counters &counters);
+
+  bool add_segment(uint32_t start, uint32_t end, char const *name, char const *sclass);
+  bool load_bytes(uint32_t ea, void const *data, size_t size, uint64_t file_offset);
+  void patch_bytes(uint32_t ea, void const *data, size_t size);
+  void put_bytes(uint32_t ea, void const *data, size_t size);
+  void set_name(uint32_t ea, char const *name);
+  void add_comment(uint32_t ea, char const *text);
+  void add_program_comment(char const *text);
+  void add_export(uint32_t ea, char const *name);
+
+private:
+  counting_sink(counting_sink const &);
+  counting_sink &operator =(counting_sink const &);
+
+  image_sink &m_sink;
+  load_counters &m_counters;
+};
+
+// Prints the report through rel_msg
+void print_load_stats(char const *name, load_timings const &timings, load_counters const &counters);
+
+// Writes the report as one JSON object, indented by indent spaces
+void write_load_stats(FILE *fp, char const *name, load_timings const &timings, load_counters const &counters, int indent = 0);
+
+// Writes a file holding just the one report
+bool save_load_stats(char const *path, char const *name, load_timings const &timings, load_counters const &counters);
+
+#endif // #ifndef __LOAD_STATS_H__
@@ -0,0 +1,53 @@
+#include "load_timer.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static char const * const phase_names[PHASE_COUNT] =
+{
+  "read_header",
+  "read_sections",
+  "init_resolvers",
+  "create_sections",
+  "section_data",
+  "self_relocations",
+  "external_relocations",
+  "apply_names"
+};
+
+char const *load_phase_name(load_phase phase)
+{
+  if ( phase < 0 || phase >= PHASE_COUNT )
+    return "unknown";
+  return phase_names[phase];
+}
+
+uint64_t load_timer_usec()
+{
+#ifdef _WIN32
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return static_cast<uint64_t>(count.QuadPart / freq.QuadPart * 1000000 + count.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+#else
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000 + static_cast<uint64_t>(ts.tv_nsec) / 1000;
+#endif
+}
+
+load_timings::load_timings()
+{
+  for ( int i = 0; i < PHASE_COUNT; ++i )
+    m_usec[i] = 0;
+}
+
+void load_timings::add(load_timings const &other)
+{
+  for ( int i = 0; i < PHASE_COUNT; ++i )
+    m_usec[i] += other.m_usec[i];
+}
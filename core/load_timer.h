@@ -0,0 +1,60 @@
+#ifndef __LOAD_TIMER_H__
+#define __LOAD_TIMER_H__
+
+#include <cstdint>
+
+// Phases of loading one module, in the order they run
+enum load_phase
+{
+  PHASE_READ_HEADER = 0,      // read_header and validate_header
+  PHASE_READ_SECTIONS,        // section table
+  PHASE_INIT_RESOLVERS,       // sibling module scan
+  PHASE_CREATE_SECTIONS,      // segment creation
+  PHASE_SECTION_DATA,         // section contents copied to the buffers relocations patch
+  PHASE_SELF_RELOCATIONS,
+  PHASE_EXTERNAL_RELOCATIONS, // including the XTRN segment
+  PHASE_APPLY_NAMES,
+  PHASE_COUNT
+};
+
+char const *load_phase_name(load_phase phase);
+
+// Monotonic clock in microseconds
+uint64_t load_timer_usec();
+
+// Time spent in each phase, accumulated over repeated runs
+struct load_timings
+{
+  load_timings();
+
+  // Adds the times of another load, e.g. each module of a linked load
+  void add(load_timings const &other);
+
+  uint64_t m_usec[PHASE_COUNT];
+};
+
+// Adds the lifetime of the scope to one phase
+class load_phase_scope
+{
+public:
+  load_phase_scope(load_timings &timings, load_phase phase)
+    : m_timings(timings)
+    , m_phase(phase)
+    , m_start(load_timer_usec())
+  {}
+
+  ~load_phase_scope()
+  {
+    m_timings.m_usec[m_phase] += load_timer_usec() - m_start;
+  }
+
+private:
+  load_phase_scope(load_phase_scope const &);
+  load_phase_scope &operator =(load_phase_scope const &);
+
+  load_timings &m_timings;
+  load_phase m_phase;
+  uint64_t m_start;
+};
+
+#endif // #ifndef __LOAD_TIMER_H__
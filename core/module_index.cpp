@@ -0,0 +1,233 @@
+#include "module_index.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <set>
+#include <cstring>
+#include <cctype>
+
+#define MODULE_INDEX_MAGIC    0x58494C52   // 'RLIX'
+#define MODULE_INDEX_VERSION  6   // 2: v1/v2 modules with short headers are accepted, 3: Yaz0 modules, 4: archives,
+                                  // 5: placement fields, 6: keyed by relative path, archive member paths
+#define MODULE_INDEX_MAX_NAME 260
+#define MODULE_INDEX_MAX_MODULES 0x10000
+
+// The index is only ever read back by the same plugin, so it is stored in host order
+template <typename T>
+static bool read_pod(FILE *fp, T &value)
+{
+  return fread(&value, sizeof(value), 1, fp) == 1;
+}
+
+template <typename T>
+static bool write_pod(FILE *fp, T const &value)
+{
+  return fwrite(&value, sizeof(value), 1, fp) == 1;
+}
+
+static bool read_string(FILE *fp, std::string &value, bool allow_empty = false)
+{
+  uint32_t size = 0;
+  if ( !read_pod(fp, size) || (size == 0 && !allow_empty) || size >= MODULE_INDEX_MAX_NAME )
+    return false;
+  value.resize(size);
+  return size == 0 || fread(&value[0], 1, size, fp) == size;
+}
+
+static bool write_string(FILE *fp, std::string const &value)
+{
+  uint32_t size = static_cast<uint32_t>(value.size());
+  return write_pod(fp, size) && fwrite(value.c_str(), 1, size, fp) == size;
+}
+
+bool get_file_stamp(char const *path, uint64_t &size, uint64_t &mtime)
+{
+  struct stat st;
+  if ( stat(path, &st) != 0 )
+    return false;
+
+  size  = static_cast<uint64_t>(st.st_size);
+  mtime = static_cast<uint64_t>(st.st_mtime);
+  return true;
+}
+
+std::string file_basename(std::string const &path)
+{
+  size_t sep = path.find_last_of("/\\");
+  return sep == std::string::npos ? path : path.substr(sep + 1);
+}
+
+std::string module_index_key(std::string const &path, std::string const &index_path)
+{
+  // The directory without its trailing separator, either kind of separator may follow it in the path
+  size_t dir_size = index_path.size() - file_basename(index_path).size();
+  if ( dir_size == 0 )
+    return path;
+  --dir_size;
+
+  if ( path.size() > dir_size + 1 && path.compare(0, dir_size, index_path, 0, dir_size) == 0 &&
+       (path[dir_size] == '/' || path[dir_size] == '\\') )
+    return path.substr(dir_size + 1);
+  return path;
+}
+
+static bool has_extension(std::string const &filename, char const *ext)
+{
+  size_t len = strlen(ext);
+  if ( filename.size() <= len )
+    return false;
+  for ( size_t i = 0; i < len; ++i )
+  {
+    if ( tolower(static_cast<unsigned char>(filename[filename.size() - len + i])) != ext[i] )
+      return false;
+  }
+  return true;
+}
+
+char const * const module_source_extensions[] = { ".rel", ".szs", ".arc", ".carc", ".gcm", ".iso", nullptr };
+
+bool is_module_source(std::string const &filename)
+{
+  for ( char const * const *ext = module_source_extensions; *ext != nullptr; ++ext )
+  {
+    if ( has_extension(filename, *ext) )
+      return true;
+  }
+  return false;
+}
+
+std::string module_stem(std::string const &filename)
+{
+  std::string stem(filename);
+  if ( has_extension(stem, ".szs") )
+    stem.resize(stem.size() - 4);
+  return stem.substr(0, stem.find_last_of('.'));
+}
+
+module_index::module_index()
+  : m_dirty(false)
+{}
+
+bool module_index::load(char const *path)
+{
+  m_entries.clear();
+  m_dirty = false;
+
+  FILE *fp = fopen(path, "rb");
+  if ( fp == nullptr )
+    return false;
+
+  uint32_t magic = 0, version = 0, count = 0;
+  bool ok = read_pod(fp, magic) && read_pod(fp, version) && read_pod(fp, count) &&
+            magic == MODULE_INDEX_MAGIC && version == MODULE_INDEX_VERSION;
+
+  for ( uint32_t i = 0; ok && i < count; ++i )
+  {
+    std::string name;
+    module_index_entry entry;
+    uint32_t num_modules = 0;
+    ok = read_string(fp, name) &&
+         read_pod(fp, entry.m_file_size) && read_pod(fp, entry.m_file_mtime) &&
+         read_pod(fp, num_modules) && num_modules <= MODULE_INDEX_MAX_MODULES;
+
+    entry.m_modules.resize(ok ? num_modules : 0);
+    for ( uint32_t m = 0; ok && m < num_modules; ++m )
+    {
+      module_info &info = entry.m_modules[m];
+      uint32_t num_sections = 0;
+      ok = read_string(fp, info.m_name) && read_string(fp, info.m_member, true) && read_pod(fp, info.m_id) && read_pod(fp, info.m_bss_size) &&
+           read_pod(fp, info.m_placement) && read_pod(fp, num_sections) && num_sections <= REL_MAX_SECTIONS;
+
+      info.m_sections.resize(ok ? num_sections : 0);
+      for ( uint32_t s = 0; ok && s < num_sections; ++s )
+        ok = read_pod(fp, info.m_sections[s].file_offset) && read_pod(fp, info.m_sections[s].size);
+    }
+
+    if ( ok )
+      m_entries[name] = entry;
+  }
+  fclose(fp);
+
+  // A damaged index is just thrown away and rebuilt
+  if ( !ok )
+  {
+    m_entries.clear();
+    m_dirty = true;
+  }
+  return ok;
+}
+
+bool module_index::save(char const *path) const
+{
+  FILE *fp = fopen(path, "wb");
+  if ( fp == nullptr )
+    return false;
+
+  uint32_t count = static_cast<uint32_t>(m_entries.size());
+  bool ok = write_pod(fp, static_cast<uint32_t>(MODULE_INDEX_MAGIC)) &&
+            write_pod(fp, static_cast<uint32_t>(MODULE_INDEX_VERSION)) &&
+            write_pod(fp, count);
+
+  for ( auto it = m_entries.begin(); ok && it != m_entries.end(); ++it )
+  {
+    module_index_entry const &entry = it->second;
+    uint32_t num_modules = static_cast<uint32_t>(entry.m_modules.size());
+
+    ok = write_string(fp, it->first) &&
+         write_pod(fp, entry.m_file_size) && write_pod(fp, entry.m_file_mtime) &&
+         write_pod(fp, num_modules);
+
+    for ( uint32_t m = 0; ok && m < num_modules; ++m )
+    {
+      module_info const &info = entry.m_modules[m];
+      uint32_t num_sections = static_cast<uint32_t>(info.m_sections.size());
+      ok = write_string(fp, info.m_name) && write_string(fp, info.m_member) && write_pod(fp, info.m_id) && write_pod(fp, info.m_bss_size) &&
+           write_pod(fp, info.m_placement) && write_pod(fp, num_sections);
+
+      for ( uint32_t s = 0; ok && s < num_sections; ++s )
+        ok = write_pod(fp, info.m_sections[s].file_offset) && write_pod(fp, info.m_sections[s].size);
+    }
+  }
+  fclose(fp);
+  return ok;
+}
+
+module_index_entry const *module_index::find(std::string const &filename, uint64_t size, uint64_t mtime) const
+{
+  auto it = m_entries.find(filename);
+  if ( it == m_entries.end() || it->second.m_file_size != size || it->second.m_file_mtime != mtime )
+    return nullptr;
+  return &it->second;
+}
+
+void module_index::update(std::string const &filename, module_index_entry const &entry)
+{
+  m_entries[filename] = entry;
+  m_dirty = true;
+}
+
+void module_index::retain(std::vector<std::string> const &filenames)
+{
+  std::set<std::string> keep(filenames.begin(), filenames.end());
+  for ( auto it = m_entries.begin(); it != m_entries.end(); )
+  {
+    if ( keep.count(it->first) == 0 )
+    {
+      m_entries.erase(it++);
+      m_dirty = true;
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+std::map<std::string, module_index_entry> const &module_index::entries() const
+{
+  return m_entries;
+}
+
+bool module_index::is_dirty() const
+{
+  return m_dirty;
+}
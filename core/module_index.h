@@ -0,0 +1,78 @@
+#ifndef __MODULE_INDEX_H__
+#define __MODULE_INDEX_H__
+
+#include "rel.h"
+#include <string>
+#include <vector>
+#include <map>
+
+#define MODULE_INDEX_NAME "rel_modules.idx"
+
+// What is known about a sibling module, enough to resolve imports into it
+struct module_info
+{
+  std::string m_name;     // file name without extensions
+  std::string m_member;   // path inside the archive it was read from, empty for a plain file
+  uint32_t m_id;
+  uint32_t m_bss_size;
+  module_placement m_placement;
+  std::vector<section_entry> m_sections;
+};
+
+struct module_index_entry
+{
+  uint64_t m_file_size;
+  uint64_t m_file_mtime;
+  std::vector<module_info> m_modules;   // one for a REL, any number for an archive, none for other files
+};
+
+// On-disk cache of module headers in a directory, keyed by the file's path relative to the index
+// (see module_index_key), so files of the same name in different places keep their own entries.
+// Archive members are listed under their archive, each with its member path.
+// Files without modules are kept too, so they aren't reparsed either.
+// An entry is only trusted while the file's size and modification time still match.
+class module_index
+{
+public:
+  module_index();
+
+  bool load(char const *path);
+  bool save(char const *path) const;
+
+  // Retrieves the cached entry for a file if it is still current
+  module_index_entry const *find(std::string const &filename, uint64_t size, uint64_t mtime) const;
+
+  void update(std::string const &filename, module_index_entry const &entry);
+
+  // Drops entries for files that no longer exist
+  void retain(std::vector<std::string> const &filenames);
+
+  std::map<std::string, module_index_entry> const &entries() const;
+
+  bool is_dirty() const;
+
+private:
+  std::map<std::string, module_index_entry> m_entries;
+  bool m_dirty;
+};
+
+// Strips the directory part of a path
+std::string file_basename(std::string const &path);
+
+// Key of a file in the index at index_path: its path relative to the index's directory,
+// the whole path if it is somewhere else
+std::string module_index_key(std::string const &path, std::string const &index_path);
+
+// Extensions of files that modules are read from: RELs, Yaz0 files, archives and disc images. Ends with nullptr.
+extern char const * const module_source_extensions[];
+
+// Whether a file may hold modules, judging by its extension
+bool is_module_source(std::string const &filename);
+
+// Module name for a file name: without its extension, and without ".szs" in front of that
+std::string module_stem(std::string const &filename);
+
+// Retrieves the size and modification time of a file
+bool get_file_stamp(char const *path, uint64_t &size, uint64_t &mtime);
+
+#endif // #ifndef __MODULE_INDEX_H__
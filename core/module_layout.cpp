@@ -0,0 +1,118 @@
+#include "module_layout.h"
+#include "rel_kernels.h"
+#include <algorithm>
+#include <utility>
+
+// Rounds up to a multiple of align, which the header may give as 0
+static uint32_t align_up(uint32_t value, uint32_t align)
+{
+  return align > 1 ? (value + align - 1) / align * align : value;
+}
+
+uint32_t place_module_sections(module_placement const &placement, section_entry const *sections, size_t count,
+                               uint32_t base, uint32_t *addresses)
+{
+  for ( size_t i = 0; i < count; ++i )
+    addresses[i] = REL_NO_ADDRESS;
+
+  // Version 1 says nothing about alignment, sections follow each other in file order
+  if ( placement.version < 2 )
+  {
+    uint32_t next = base;
+    for ( size_t i = 0; i < count; ++i )
+    {
+      if ( sections[i].file_offset == 0 && sections[i].size == 0 )
+        continue;
+      addresses[i] = next;
+      next += sections[i].size;
+    }
+    return next;
+  }
+
+  // Later versions are laid out the way OSLink has them: the module is loaded at an address aligned
+  // to align and its sections stay at their file offsets, which the linker aligned already
+  uint32_t start = align_up(base, placement.align);
+  uint32_t end = start;
+  int bss = -1;
+  for ( size_t i = 0; i < count; ++i )
+  {
+    section_entry const &entry = sections[i];
+    if ( entry.file_offset == 0 && entry.size == 0 )
+      continue;
+
+    if ( SECTION_OFF(entry.file_offset) == 0 )
+    {
+      bss = static_cast<int>(i);
+      continue;
+    }
+
+    addresses[i] = start + SECTION_OFF(entry.file_offset);
+    end = std::max(end, start + SECTION_OFF(entry.file_offset) + entry.size);
+  }
+
+  // The BSS goes behind the module aligned to bss_align. OSLinkFixed (version 3) frees everything
+  // past fix_size once the module is linked, and that is where the BSS goes then.
+  uint32_t bss_start = start + placement.file_size;
+  if ( placement.version >= 3 && start + placement.fix_size >= end && placement.fix_size <= placement.file_size )
+    bss_start = start + placement.fix_size;
+  if ( bss < 0 )
+    return end;
+
+  addresses[bss] = align_up(bss_start, placement.bss_align);
+  return std::max(end, addresses[bss] + sections[bss].size);
+}
+
+module_layout::module_layout()
+{}
+
+void module_layout::clear()
+{
+  m_rows.clear();
+  m_addresses.clear();
+  m_names.clear();
+  m_map_dirs.clear();
+}
+
+void module_layout::add_dol()
+{
+  // Every section of the DOL is based at 0
+  auto ins = m_rows.insert(std::make_pair(0u, static_cast<uint32_t>(m_addresses.size())));
+  if ( ins.second )
+    m_addresses.resize(m_addresses.size() + LAYOUT_ROW_SIZE);
+  std::fill(m_addresses.begin() + ins.first->second, m_addresses.begin() + ins.first->second + LAYOUT_ROW_SIZE, 0u);
+}
+
+void module_layout::add_module(uint32_t id, char const *name, uint32_t const *addresses, size_t count)
+{
+  auto ins = m_rows.insert(std::make_pair(id, static_cast<uint32_t>(m_addresses.size())));
+  if ( ins.second )
+    m_addresses.resize(m_addresses.size() + LAYOUT_ROW_SIZE);
+
+  uint32_t *row = &m_addresses[ins.first->second];
+  for ( size_t i = 0; i < LAYOUT_ROW_SIZE; ++i )
+    row[i] = i < count ? addresses[i] : REL_NO_ADDRESS;
+  m_names[id] = name;
+}
+
+void module_layout::add_map_dir(std::string const &dir)
+{
+  if ( std::find(m_map_dirs.begin(), m_map_dirs.end(), dir) == m_map_dirs.end() )
+    m_map_dirs.push_back(dir);
+}
+
+std::vector<std::string> const &module_layout::map_dirs() const
+{
+  return m_map_dirs;
+}
+
+uint32_t const *module_layout::sections(uint32_t id) const
+{
+  auto it = m_rows.find(id);
+  return it != m_rows.end() ? &m_addresses[it->second] : nullptr;
+}
+
+char const *module_layout::name(uint32_t id) const
+{
+  auto it = m_names.find(id);
+  return it != m_names.end() ? it->second.c_str() : nullptr;
+}
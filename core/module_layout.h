@@ -0,0 +1,51 @@
+#ifndef __MODULE_LAYOUT_H__
+#define __MODULE_LAYOUT_H__
+
+#include "rel.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// Lays out the sections of a module loaded at base like OSLink, one address per section and REL_NO_ADDRESS
+// for unused ones. Version 1 modules start their first section at base, later versions keep their sections at
+// the file offsets from base aligned to align. Returns the first address past the module.
+uint32_t place_module_sections(module_placement const &placement, section_entry const *sections, size_t count,
+                               uint32_t base, uint32_t *addresses);
+
+// One address per possible section number, so a relocation's section needs no bounds check
+#define LAYOUT_ROW_SIZE 256
+
+// Where every module of a linked load is placed (see game_link), so that imports between them
+// are patched to their real targets. Filled in before any module is relocated, then only read.
+class module_layout
+{
+public:
+  module_layout();
+
+  void clear();
+
+  // Imports from module 0 are absolute addresses in the DOL, they resolve to their addend
+  void add_dol();
+
+  // Section addresses of a module, REL_NO_ADDRESS for sections that aren't loaded.
+  // A module id that is placed twice resolves to the last one.
+  void add_module(uint32_t id, char const *name, uint32_t const *addresses, size_t count);
+
+  // Linker maps are looked for in these directories, like next to sibling modules
+  void add_map_dir(std::string const &dir);
+  std::vector<std::string> const &map_dirs() const;
+
+  // LAYOUT_ROW_SIZE section addresses of a module, nullptr if it isn't part of the load
+  uint32_t const *sections(uint32_t id) const;
+
+  // nullptr if the module isn't part of the load
+  char const *name(uint32_t id) const;
+
+private:
+  std::unordered_map<uint32_t, uint32_t> m_rows;    // id -> first entry in m_addresses
+  std::vector<uint32_t> m_addresses;
+  std::unordered_map<uint32_t, std::string> m_names;
+  std::vector<std::string> m_map_dirs;
+};
+
+#endif // #ifndef __MODULE_LAYOUT_H__
@@ -0,0 +1,151 @@
+#include "module_scan.h"
+#include "yaz0.h"
+#include "archive.h"
+#include "parallel.h"
+#include <cstdio>
+
+bool check_module_header(relhdr const *hdr, section_entry_be const *table, uint64_t file_size, module_probe &probe)
+{
+  uint32_t num_sections = hdr->info.num_sections;
+  uint32_t section_offset = hdr->info.section_offset;
+  uint32_t version = hdr->info.version;
+  uint32_t bss_size = hdr->bss_size;
+
+  // Same limits as rel_track::validate_header
+  if ( version == 0 || version > 3 )
+    return false;
+  if ( num_sections > REL_MAX_SECTIONS || num_sections <= 1 )
+    return false;
+
+  uint64_t table_offset = SECTION_OFF(section_offset);
+  if ( table_offset < rel_header_size(version) || table_offset + num_sections*sizeof(section_entry_be) > file_size )
+    return false;
+
+  // Same checks as rel_track::read_sections
+  for ( uint32_t i = 0; i < num_sections; ++i )
+  {
+    section_entry &entry = probe.m_sections[i];
+    entry.file_offset = table[i].file_offset;
+    entry.size = table[i].size;
+
+    if ( entry.file_offset == 0 && entry.size != 0 )
+    {
+      if ( entry.size != bss_size )
+        return false;
+    }
+    else if ( entry.file_offset != 0 && entry.size != 0 )
+    {
+      uint64_t offset = SECTION_OFF(entry.file_offset);
+      if ( offset < rel_header_size(version) || offset + entry.size > file_size )
+        return false;
+    }
+  }
+
+  probe.m_file_size = file_size;
+  probe.m_id = hdr->info.id;
+  probe.m_bss_size = bss_size;
+  probe.m_num_sections = num_sections;
+  probe.m_placement.version = version;
+  probe.m_placement.align = version >= 2 ? hdr->align.get() : 0;
+  probe.m_placement.bss_align = version >= 2 ? hdr->bss_align.get() : 0;
+  probe.m_placement.fix_size = version >= 3 ? hdr->fix_size.get() : 0;
+  probe.m_placement.file_size = static_cast<uint32_t>(file_size);
+  return true;
+}
+
+bool probe_module(input_source &input, module_probe &probe)
+{
+  uint64_t file_size = input.size();
+  if ( file_size < sizeof(relhdr) )
+    return false;
+
+  // One read covers the header and, normally, the section table
+  probe.m_head_size = static_cast<uint32_t>(file_size < MODULE_PROBE_SIZE ? file_size : MODULE_PROBE_SIZE);
+  if ( !input.read(0, probe.m_head, probe.m_head_size) )
+    return false;
+
+  relhdr const *hdr = be_view<relhdr>(probe.m_head, probe.m_head_size);
+  uint32_t num_sections = hdr->info.num_sections;
+  uint32_t section_offset = hdr->info.section_offset;
+  if ( num_sections > REL_MAX_SECTIONS )
+    return false;
+
+  // A table elsewhere in the file takes a second read of at most REL_MAX_SECTIONS entries
+  section_entry_be table_buf[REL_MAX_SECTIONS];
+  section_entry_be const *table = be_view<section_entry_be>(probe.m_head, probe.m_head_size, section_offset);
+  if ( table == nullptr || section_offset + static_cast<uint64_t>(num_sections)*sizeof(section_entry_be) > probe.m_head_size )
+  {
+    if ( !input.read(section_offset, table_buf, num_sections*sizeof(section_entry_be)) )
+      return false;
+    table = table_buf;
+  }
+
+  return check_module_header(hdr, table, file_size, probe);
+}
+
+bool load_module_info(input_source &input, std::string const &name, module_info &info)
+{
+  module_probe probe;
+  if ( !probe_module(input, probe) )
+    return false;
+
+  info.m_name = module_stem(file_basename(name));
+  info.m_id = probe.m_id;
+  info.m_bss_size = probe.m_bss_size;
+  info.m_placement = probe.m_placement;
+  info.m_sections.assign(probe.m_sections, probe.m_sections + probe.m_num_sections);
+  return true;
+}
+
+bool load_module_file(char const *path, std::vector<module_info> &modules)
+{
+  // Plain stdio so this can run off the main thread, compressed files are read through the decoder
+  file_source file(path);
+  if ( !file.is_open() )
+    return false;
+  yaz0_source input(file);
+
+  modules.clear();
+  if ( !is_archive(input) )
+  {
+    module_info info;
+    if ( load_module_info(input, path, info) )
+      modules.push_back(info);
+    return true;
+  }
+
+  // Members are probed in place, an archive only needs its file table read
+  std::vector<archive_member> members;
+  if ( !read_archive(input, members) )
+    return true;
+
+  for ( auto it = members.begin(); it != members.end(); ++it )
+  {
+    if ( !is_module_source(it->m_path) )
+      continue;
+
+    slice_source slice(input, it->m_offset, it->m_size);
+    yaz0_source member(slice);
+    module_info info;
+    if ( load_module_info(member, it->m_path, info) )
+    {
+      info.m_member = it->m_path;
+      modules.push_back(info);
+    }
+  }
+  return true;
+}
+
+static void scan_one(std::vector<std::string> const &paths, std::vector<module_index_entry> &entries, size_t i)
+{
+  module_index_entry &entry = entries[i];
+  load_module_file(paths[i].c_str(), entry.m_modules);
+}
+
+void scan_module_files(std::vector<std::string> const &paths, std::vector<module_index_entry> &entries)
+{
+  parallel_for_index(paths.size(), [&](size_t i)
+  {
+    scan_one(paths, entries, i);
+  });
+}
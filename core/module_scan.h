@@ -0,0 +1,46 @@
+#ifndef __MODULE_SCAN_H__
+#define __MODULE_SCAN_H__
+
+#include "module_index.h"
+#include "input_source.h"
+#include <string>
+#include <vector>
+
+// The probe reads this much of the start of a file, enough for a header and a section table right behind it
+#define MODULE_PROBE_SIZE (sizeof(relhdr) + REL_MAX_SECTIONS*sizeof(section_entry_be))
+
+// Result of probing a possible REL without allocating anything
+struct module_probe
+{
+  uint64_t m_file_size;
+  uint32_t m_id;
+  uint32_t m_bss_size;
+  uint32_t m_num_sections;
+  module_placement m_placement;
+  section_entry m_sections[REL_MAX_SECTIONS];
+
+  // Start of the file as read by the probe, so a following load doesn't read it again
+  uint8_t m_head[MODULE_PROBE_SIZE];
+  uint32_t m_head_size;
+};
+
+// Validates a REL header and its section table. Quiet and allocation free, the same checks as
+// rel_track::validate_header and rel_track::read_sections.
+bool check_module_header(relhdr const *hdr, section_entry_be const *table, uint64_t file_size, module_probe &probe);
+
+// Checks whether a file is a REL with at most two small bounded reads
+bool probe_module(input_source &input, module_probe &probe);
+
+// Reads just the header and section table of a REL, which may be Yaz0 compressed
+bool load_module_info(input_source &input, std::string const &name, module_info &info);
+
+// Reads the headers of all modules in a file on disk: a REL, or the RELs inside a U8/RARC archive.
+// Either may be Yaz0 compressed. Returns false if the file can't be read at all.
+bool load_module_file(char const *path, std::vector<module_info> &modules);
+
+// Scans the given files concurrently. entries must be the same size as paths with the file
+// stamps already filled in; m_modules is set for each slot, so the result order
+// always matches the input order regardless of thread timing.
+void scan_module_files(std::vector<std::string> const &paths, std::vector<module_index_entry> &entries);
+
+#endif // #ifndef __MODULE_SCAN_H__
@@ -0,0 +1,16 @@
+#include "parallel.h"
+#include <cstdlib>
+
+unsigned parallel_threads()
+{
+  char const *value = getenv(PARALLEL_THREADS_ENV);
+  if ( value != nullptr && atoi(value) > 0 )
+    return static_cast<unsigned>(atoi(value));
+
+#ifdef _MSC_VER
+  return Concurrency::GetProcessorCount();
+#else
+  unsigned cores = std::thread::hardware_concurrency();
+  return cores != 0 ? cores : 1;
+#endif
+}
@@ -0,0 +1,81 @@
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <cstddef>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <ppl.h>
+#else
+#include <atomic>
+#include <exception>
+#include <thread>
+#endif
+
+// Set to the most threads to use, 1 runs everything on the calling thread
+#define PARALLEL_THREADS_ENV "WII_LOADER_THREADS"
+
+// Threads parallel_for_index runs on, WII_LOADER_THREADS if it is set and one per core otherwise
+unsigned parallel_threads();
+
+// Runs body(i) for every i in [0, count) and returns once all are done. The body must only touch
+// what belongs to its index, and must not print: IDA's msg is only safe on the main thread.
+//
+// Visual C++ uses PPL. Elsewhere a std::thread per core takes the next index as it goes, since
+// files differ a lot in size. The first exception a body throws is rethrown on the calling thread.
+template <typename Body>
+void parallel_for_index(size_t count, Body const &body)
+{
+  unsigned threads = parallel_threads();
+  if ( threads <= 1 || count <= 1 )
+  {
+    for ( size_t i = 0; i < count; ++i )
+      body(i);
+    return;
+  }
+
+#ifdef _MSC_VER
+  Concurrency::parallel_for(size_t(0), count, [&](size_t i)
+  {
+    body(i);
+  });
+#else
+  if ( threads > count )
+    threads = static_cast<unsigned>(count);
+
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  workers.reserve(threads - 1);
+
+  auto work = [&](unsigned worker)
+  {
+    try
+    {
+      for ( size_t i = next++; i < count && !failed; i = next++ )
+        body(i);
+    }
+    catch ( ... )
+    {
+      errors[worker] = std::current_exception();
+      failed = true;
+    }
+  };
+
+  // The calling thread is one of the workers
+  for ( unsigned t = 1; t < threads; ++t )
+    workers.push_back(std::thread(work, t));
+  work(0);
+  for ( size_t t = 0; t < workers.size(); ++t )
+    workers[t].join();
+
+  for ( size_t t = 0; t < errors.size(); ++t )
+  {
+    if ( errors[t] )
+      std::rethrow_exception(errors[t]);
+  }
+#endif
+}
+
+#endif // #ifndef __PARALLEL_H__
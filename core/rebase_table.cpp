@@ -0,0 +1,95 @@
+#include "rebase_table.h"
+#include "rel_kernels.h"
+#include <cstring>
+
+#define REBASE_TABLE_MAGIC    0x42524C52   // 'RLRB'
+#define REBASE_TABLE_VERSION  1
+#define REBASE_ENTRY_SIZE     (2*sizeof(uint32_t) + 1)
+
+void rebase_table::clear()
+{
+  m_where.clear();
+  m_targets.clear();
+  m_types.clear();
+}
+
+size_t rebase_table::size() const
+{
+  return m_types.size();
+}
+
+size_t rebase_table::move(uint32_t from, uint32_t to, uint32_t size, rebase_memory &memory)
+{
+  uint32_t delta = to - from;
+  size_t patched = 0;
+  for ( size_t i = 0; i < m_types.size(); ++i )
+  {
+    bool where_moves = m_where[i] - from < size;
+    bool target_moves = m_targets[i] - from < size;
+    if ( !where_moves && !target_moves )
+      continue;
+
+    uint32_t where = m_where[i] += where_moves ? delta : 0;
+    uint32_t target = m_targets[i] += target_moves ? delta : 0;
+
+    rel_kind const &kind = rel_kinds[m_types[i]];
+    if ( where_moves && target_moves && (kind.m_flags & REL_KIND_RELATIVE) != 0 )
+      continue;
+
+    uint8_t buf[4];
+    if ( !memory.read(where, buf, kind.m_size) )
+      continue;
+    kind.m_apply(buf, where, target);
+    memory.write(where, buf, kind.m_size);
+    ++patched;
+  }
+  return patched;
+}
+
+void rebase_table::save(std::vector<uint8_t> &blob) const
+{
+  uint32_t header[3] = { REBASE_TABLE_MAGIC, REBASE_TABLE_VERSION, static_cast<uint32_t>(m_types.size()) };
+  size_t count = m_types.size();
+
+  blob.resize(sizeof(header) + count*REBASE_ENTRY_SIZE);
+  uint8_t *p = &blob[0];
+  memcpy(p, header, sizeof(header));
+  p += sizeof(header);
+  if ( count == 0 )
+    return;
+
+  memcpy(p, &m_where[0], count*sizeof(uint32_t));
+  p += count*sizeof(uint32_t);
+  memcpy(p, &m_targets[0], count*sizeof(uint32_t));
+  p += count*sizeof(uint32_t);
+  memcpy(p, &m_types[0], count);
+}
+
+bool rebase_table::load(void const *blob, size_t size)
+{
+  uint32_t header[3];
+  this->clear();
+  if ( size < sizeof(header) )
+    return false;
+
+  uint8_t const *p = static_cast<uint8_t const *>(blob);
+  memcpy(header, p, sizeof(header));
+  p += sizeof(header);
+  size_t count = header[2];
+  if ( header[0] != REBASE_TABLE_MAGIC || header[1] != REBASE_TABLE_VERSION )
+    return false;
+  if ( size - sizeof(header) != count*REBASE_ENTRY_SIZE )
+    return false;
+  if ( count == 0 )
+    return true;
+
+  m_where.resize(count);
+  m_targets.resize(count);
+  m_types.resize(count);
+  memcpy(&m_where[0], p, count*sizeof(uint32_t));
+  p += count*sizeof(uint32_t);
+  memcpy(&m_targets[0], p, count*sizeof(uint32_t));
+  p += count*sizeof(uint32_t);
+  memcpy(&m_types[0], p, count);
+  return true;
+}
@@ -0,0 +1,49 @@
+#ifndef __REBASE_TABLE_H__
+#define __REBASE_TABLE_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Bytes of a loaded image that relocations are applied to again
+class rebase_memory
+{
+public:
+  virtual ~rebase_memory() {}
+
+  virtual bool read(uint32_t ea, void *dst, size_t size) = 0;
+  virtual void write(uint32_t ea, void const *data, size_t size) = 0;
+};
+
+// Every relocation that was patched into an image, by address, so the image can be moved later
+// without reading the module again. One array per field like rel_stream, about 9 bytes a relocation.
+class rebase_table
+{
+public:
+  void clear();
+
+  void add(uint32_t where, uint8_t type, uint32_t target)
+  {
+    m_where.push_back(where);
+    m_targets.push_back(target);
+    m_types.push_back(type);
+  }
+
+  size_t size() const;
+
+  // Updates the table for [from, from + size) having moved to to, and patches every relocation
+  // whose value changed. A relative relocation that moves along with its target is left alone.
+  // Returns the number of relocations patched.
+  size_t move(uint32_t from, uint32_t to, uint32_t size, rebase_memory &memory);
+
+  // Flat form for storing the table with the image, in host order
+  void save(std::vector<uint8_t> &blob) const;
+  bool load(void const *blob, size_t size);
+
+private:
+  std::vector<uint32_t> m_where;
+  std::vector<uint32_t> m_targets;
+  std::vector<uint8_t>  m_types;
+};
+
+#endif // #ifndef __REBASE_TABLE_H__
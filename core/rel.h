@@ -0,0 +1,198 @@
+/*
+*  IDA Nintendo GameCube RSO Loader Module
+*  (C) Copyright 2010 Stephen Simpson
+*
+*/
+
+#ifndef __REL_H__
+#define __REL_H__
+
+//#define DEBUG
+#define START  0x80500000
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include "be_field.h"
+
+// Output hook, implemented by the front end (IDA's output window, stderr, ...)
+int rel_vmsg(const char *format, va_list va);
+
+// The on-disk structures below are big endian views, laid directly over the file contents
+
+typedef struct {
+  be_u32 id;          // in .rso or .rel, not in .sel
+
+  // in .rso or .rel or .sel
+  be_u32 prev;
+  be_u32 next;
+  be_u32 num_sections;
+  be_u32 section_offset;    // points to section_entry*
+  be_u32 name_offset;
+  be_u32 name_size;
+  be_u32 version;
+} relhdr_info;
+
+typedef struct {
+  relhdr_info info;
+
+  // version 1
+  be_u32 bss_size;
+  be_u32 rel_offset;
+  be_u32 import_offset;
+  be_u32 import_size;         // size in bytes
+
+  // Section ids containing functions
+  uint8_t prolog_section;
+  uint8_t epilog_section;
+  uint8_t unresolved_section;
+  uint8_t bss_section;
+
+  be_u32 prolog_offset;
+  be_u32 epilog_offset;
+  be_u32 unresolved_offset;
+
+  // version 2
+  be_u32 align;
+  be_u32 bss_align;
+
+  // version 3
+  be_u32 fix_size;
+} relhdr;
+
+
+// Section table entry in host order
+typedef struct {
+  uint32_t file_offset;
+  uint32_t size;
+} section_entry;
+
+// Header fields that decide where the sections are loaded, in host order
+typedef struct {
+  uint32_t version;
+  uint32_t align;       // version 2
+  uint32_t bss_align;   // version 2
+  uint32_t fix_size;    // version 3
+  uint32_t file_size;
+} module_placement;
+
+// Section table entry on disk
+typedef struct {
+  be_u32 file_offset;
+  be_u32 size;
+} section_entry_be;
+
+typedef struct {
+  be_u32 id;        // module id, maps to id in relhdr_info, 0 = base application
+  be_u32 offset;
+} import_entry;
+
+static_assert(sizeof(relhdr) == 0x4C, "relhdr must match the file layout");
+static_assert(sizeof(section_entry_be) == 8, "section_entry_be must match the file layout");
+static_assert(sizeof(import_entry) == 8, "import_entry must match the file layout");
+
+// Size of the header of each version, the section table may start right after it
+inline uint32_t rel_header_size(uint32_t version)
+{
+  if ( version >= 3 )
+    return sizeof(relhdr);
+  if ( version == 2 )
+    return offsetof(relhdr, fix_size);
+  return offsetof(relhdr, align);
+}
+
+#define REL_MAX_SECTIONS 32
+
+#define SECTION_EXEC 0x1
+#define SECTION_OFF(off) (off&~1)
+
+typedef struct {
+  be_u16   offset; // byte offset from previous entry
+  uint8_t  type;
+  uint8_t  section;
+  be_u32   addend;
+} rel_entry;
+
+static_assert(sizeof(rel_entry) == 8, "rel_entry must match the file layout");
+
+
+#define R_PPC_NONE            0
+#define R_PPC_ADDR32          1     /* S + A */
+#define R_PPC_ADDR24          2     /* (S + A) >> 2 */
+#define R_PPC_ADDR16          3     /* S + A */
+#define R_PPC_ADDR16_LO       4
+#define R_PPC_ADDR16_HI       5
+#define R_PPC_ADDR16_HA       6
+#define R_PPC_ADDR14          7
+#define R_PPC_ADDR14_BRTAKEN  8
+#define R_PPC_ADDR14_BRNTAKEN 9
+#define R_PPC_REL24           10   /* (S + A - P) >> 2 */
+#define R_PPC_REL14           11
+
+#define R_DOLPHIN_NOP     201 // C9h current offset += rel.offset
+#define R_DOLPHIN_SECTION 202 // CAh current offset = rel.section
+#define R_DOLPHIN_END     203 // CBh
+#define R_DOLPHIN_MRKREF  204 // CCh
+
+
+inline int rel_msg(const char *format, ...)
+{
+  va_list va;
+  va_start(va, format);
+  int nbytes = rel_vmsg(format, va);
+  va_end(va);
+  return nbytes;
+}
+
+inline void dbg_msg(const char *format, ...)
+{
+#ifdef DEBUG
+  va_list va;
+  va_start(va, format);
+  rel_vmsg(format, va);
+  va_end(va);
+#else
+  (void)format;
+#endif
+}
+
+inline std::string str_format(const char *format, ...)
+{
+  char buf[1024];
+  va_list va;
+  va_start(va, format);
+  int nbytes = vsnprintf(buf, sizeof(buf), format, va);
+  va_end(va);
+  buf[sizeof(buf) - 1] = '\0';
+  return nbytes < 0 ? std::string() : std::string(buf);
+}
+
+// str_format into a buffer of the caller, which is returned
+inline char const *buf_format(char *buf, size_t size, const char *format, ...)
+{
+  va_list va;
+  va_start(va, format);
+  int nbytes = vsnprintf(buf, size, format, va);
+  va_end(va);
+  buf[size - 1] = '\0';
+  if ( nbytes < 0 )
+    buf[0] = '\0';
+  return buf;
+}
+
+inline bool err_msg(const char *format, ...)
+{
+  va_list va;
+  va_start(va, format);
+  
+  std::string fmt_nl = format;
+  fmt_nl += "\n";
+
+  rel_vmsg(fmt_nl.c_str(), va);
+  va_end(va);
+  return false;
+}
+
+#endif
\ No newline at end of file
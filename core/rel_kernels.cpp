@@ -0,0 +1,48 @@
+#include "rel_kernels.h"
+
+#define REL_KIND(type)    { &rel_kernel<(type)>::apply, rel_kernel<(type)>::size, rel_kernel<(type)>::flags }
+#define REL_KIND4(type)   REL_KIND(type), REL_KIND(type + 1), REL_KIND(type + 2), REL_KIND(type + 3)
+#define REL_KIND16(type)  REL_KIND4(type), REL_KIND4(type + 4), REL_KIND4(type + 8), REL_KIND4(type + 12)
+#define REL_KIND64(type)  REL_KIND16(type), REL_KIND16(type + 16), REL_KIND16(type + 32), REL_KIND16(type + 48)
+
+rel_kind const rel_kinds[] =
+{
+  REL_KIND64(0), REL_KIND64(64), REL_KIND64(128), REL_KIND64(192)
+};
+
+static_assert(sizeof(rel_kinds) == 256 * sizeof(rel_kind), "one kind per relocation type");
+
+rel_image::rel_image()
+{
+  this->clear();
+}
+
+void rel_image::clear(load_diagnostics *diagnostics, rebase_table *rebase)
+{
+  for ( int i = 0; i < 256; ++i )
+  {
+    m_address[i] = REL_NO_ADDRESS;
+    m_data[i] = nullptr;
+    m_size[i] = 0;
+  }
+  m_diagnostics = diagnostics;
+  m_rebase = rebase;
+}
+
+void rel_image::report(uint8_t type, uint8_t section, uint32_t offset)
+{
+  if ( m_diagnostics == nullptr )
+    return;
+
+  if ( (rel_kinds[type].m_flags & REL_KIND_KNOWN) == 0 )
+    m_diagnostics->report(DIAG_UNKNOWN_RELOCATION, "type %u at section %u offset 0x%X", type, section, offset);
+  else
+    m_diagnostics->report(DIAG_RELOCATION_OUT_OF_BOUNDS, "type %u at section %u offset 0x%X (%u bytes)", type, section, offset, m_size[section]);
+}
+
+void rel_image::set_section(uint8_t section, uint32_t address, uint8_t *data, uint32_t size)
+{
+  m_address[section] = address;
+  m_data[section] = data;
+  m_size[section] = data != nullptr ? size : 0;
+}
@@ -0,0 +1,181 @@
+#ifndef __REL_KERNELS_H__
+#define __REL_KERNELS_H__
+
+#include "rel.h"
+#include "diagnostics.h"
+#include "rebase_table.h"
+
+// Kinds of relocation types
+#define REL_KIND_KNOWN     1    // listed in rel.h
+#define REL_KIND_PATCH     2    // writes to the section
+#define REL_KIND_RELATIVE  4    // target is relative to the patched address
+
+// Writes a relocation to p, which is at address where. target is S + A.
+typedef void (*rel_kernel_fn)(uint8_t *p, uint32_t where, uint32_t target);
+
+// One patch kernel per relocation type, types that aren't specialized are unknown
+template <unsigned Type>
+struct rel_kernel
+{
+  enum { size = 0, flags = 0 };
+  static void apply(uint8_t *, uint32_t, uint32_t) {}
+};
+
+// Types that only steer the relocation stream or mark something
+#define REL_KERNEL_NONE(type)                                         \
+  template <> struct rel_kernel<type>                                 \
+  {                                                                   \
+    enum { size = 0, flags = REL_KIND_KNOWN };                        \
+    static void apply(uint8_t *, uint32_t, uint32_t) {}               \
+  };
+
+REL_KERNEL_NONE(R_PPC_NONE)
+REL_KERNEL_NONE(R_DOLPHIN_NOP)
+REL_KERNEL_NONE(R_DOLPHIN_SECTION)
+REL_KERNEL_NONE(R_DOLPHIN_END)
+REL_KERNEL_NONE(R_DOLPHIN_MRKREF)
+
+#undef REL_KERNEL_NONE
+
+template <> struct rel_kernel<R_PPC_ADDR32>
+{
+  enum { size = 4, flags = REL_KIND_KNOWN | REL_KIND_PATCH };
+  static void apply(uint8_t *p, uint32_t, uint32_t target)
+  {
+    store_be32(p, target);
+  }
+};
+
+template <> struct rel_kernel<R_PPC_ADDR24>
+{
+  enum { size = 4, flags = REL_KIND_KNOWN | REL_KIND_PATCH };
+  static void apply(uint8_t *p, uint32_t, uint32_t target)
+  {
+    // Keep the opcode and AA/LK bits
+    store_be32(p, (load_be32(p) & 0xFC000003) | (target & 0x03FFFFFC));
+  }
+};
+
+template <> struct rel_kernel<R_PPC_ADDR16>
+{
+  enum { size = 2, flags = REL_KIND_KNOWN | REL_KIND_PATCH };
+  static void apply(uint8_t *p, uint32_t, uint32_t target)
+  {
+    store_be16(p, static_cast<uint16_t>(target));
+  }
+};
+
+template <> struct rel_kernel<R_PPC_ADDR16_LO>
+{
+  enum { size = 2, flags = REL_KIND_KNOWN | REL_KIND_PATCH };
+  static void apply(uint8_t *p, uint32_t, uint32_t target)
+  {
+    store_be16(p, static_cast<uint16_t>(target));
+  }
+};
+
+template <> struct rel_kernel<R_PPC_ADDR16_HI>
+{
+  enum { size = 2, flags = REL_KIND_KNOWN | REL_KIND_PATCH };
+  static void apply(uint8_t *p, uint32_t, uint32_t target)
+  {
+    store_be16(p, static_cast<uint16_t>(target >> 16));
+  }
+};
+
+template <> struct rel_kernel<R_PPC_ADDR16_HA>
+{
+  enum { size = 2, flags = REL_KIND_KNOWN | REL_KIND_PATCH };
+  static void apply(uint8_t *p, uint32_t, uint32_t target)
+  {
+    // The low half is used sign extended
+    store_be16(p, static_cast<uint16_t>((target + 0x8000) >> 16));
+  }
+};
+
+// Branch prediction hints are left as they are, like OSLink does
+template <unsigned Type>
+struct rel_kernel_addr14
+{
+  enum { size = 4, flags = REL_KIND_KNOWN | REL_KIND_PATCH };
+  static void apply(uint8_t *p, uint32_t, uint32_t target)
+  {
+    store_be32(p, (load_be32(p) & 0xFFFF0003) | (target & 0x0000FFFC));
+  }
+};
+
+template <> struct rel_kernel<R_PPC_ADDR14> : rel_kernel_addr14<R_PPC_ADDR14> {};
+template <> struct rel_kernel<R_PPC_ADDR14_BRTAKEN> : rel_kernel_addr14<R_PPC_ADDR14_BRTAKEN> {};
+template <> struct rel_kernel<R_PPC_ADDR14_BRNTAKEN> : rel_kernel_addr14<R_PPC_ADDR14_BRNTAKEN> {};
+
+template <> struct rel_kernel<R_PPC_REL24>
+{
+  enum { size = 4, flags = REL_KIND_KNOWN | REL_KIND_PATCH | REL_KIND_RELATIVE };
+  static void apply(uint8_t *p, uint32_t where, uint32_t target)
+  {
+    store_be32(p, (load_be32(p) & 0xFC000003) | ((target - where) & 0x03FFFFFC));
+  }
+};
+
+template <> struct rel_kernel<R_PPC_REL14>
+{
+  enum { size = 4, flags = REL_KIND_KNOWN | REL_KIND_PATCH | REL_KIND_RELATIVE };
+  static void apply(uint8_t *p, uint32_t where, uint32_t target)
+  {
+    store_be32(p, (load_be32(p) & 0xFFFF0003) | ((target - where) & 0x0000FFFC));
+  }
+};
+
+struct rel_kind
+{
+  rel_kernel_fn m_apply;
+  uint8_t m_size;
+  uint8_t m_flags;
+};
+
+// Every relocation type, filled in from the kernels at compile time
+extern rel_kind const rel_kinds[256];
+
+#define REL_NO_ADDRESS 0xFFFFFFFF
+
+// Host copies of a module's sections that relocations are applied to, by section number.
+// Lookups are plain indexing so the inner loops don't branch on the type or the section.
+struct rel_image
+{
+  rel_image();
+
+  // Where bad relocations are reported and where the applied ones are recorded, nullptr for neither
+  void clear(load_diagnostics *diagnostics = nullptr, rebase_table *rebase = nullptr);
+  void set_section(uint8_t section, uint32_t address, uint8_t *data, uint32_t size);
+
+  uint32_t address(uint8_t section, uint32_t offset) const
+  {
+    return m_address[section] + offset;
+  }
+
+  void apply(uint8_t type, uint8_t section, uint32_t offset, uint32_t target)
+  {
+    rel_kind const &kind = rel_kinds[type];
+    uint32_t size = m_size[section];
+
+    // Anything out of bounds is written to scratch space instead
+    bool fits = offset <= size && kind.m_size <= size - offset;
+    uint8_t *p = fits ? m_data[section] + offset : m_scratch;
+    if ( !fits || (kind.m_flags & REL_KIND_KNOWN) == 0 )
+      this->report(type, section, offset);
+    else if ( m_rebase != nullptr && (kind.m_flags & REL_KIND_PATCH) != 0 )
+      m_rebase->add(this->address(section, offset), type, target);
+    kind.m_apply(p, this->address(section, offset), target);
+  }
+
+  void report(uint8_t type, uint8_t section, uint32_t offset);
+
+  uint32_t m_address[256];    // REL_NO_ADDRESS for sections that aren't loaded
+  uint8_t *m_data[256];
+  uint32_t m_size[256];
+  uint8_t m_scratch[4];
+  load_diagnostics *m_diagnostics;
+  rebase_table *m_rebase;
+};
+
+#endif // #ifndef __REL_KERNELS_H__
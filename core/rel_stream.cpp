@@ -0,0 +1,83 @@
+#include "rel_stream.h"
+#include "rel.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define REL_STREAM_SSE2
+#include <emmintrin.h>
+#endif
+
+#define REL_ENTRY_SIZE sizeof(rel_entry)
+#define REL_TYPE_BYTE  offsetof(rel_entry, type)
+
+// Number of whole records before the terminator, or count if there is none
+static size_t find_rel_end(uint8_t const *records, size_t count)
+{
+  size_t i = 0;
+#ifdef REL_STREAM_SSE2
+  // Compare 4 records at a time, the type is byte 2 of each record
+  __m128i const end_type = _mm_set1_epi8(static_cast<char>(R_DOLPHIN_END));
+  for ( ; i + 4 <= count; i += 4 )
+  {
+    uint8_t const *p = records + i*REL_ENTRY_SIZE;
+    int lo = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)), end_type));
+    int hi = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16)), end_type));
+    unsigned mask = static_cast<unsigned>(lo | (hi << 16)) & 0x04040404;
+    if ( mask != 0 )
+    {
+      while ( (mask & 0x4) == 0 )
+      {
+        mask >>= 8;
+        ++i;
+      }
+      return i;
+    }
+  }
+#endif
+  for ( ; i < count; ++i )
+  {
+    if ( records[i*REL_ENTRY_SIZE + REL_TYPE_BYTE] == R_DOLPHIN_END )
+      return i;
+  }
+  return count;
+}
+
+bool decode_rel_stream(uint8_t const *data, size_t size, size_t pos, rel_stream &stream, size_t &end_pos)
+{
+  stream.m_offsets.clear();
+  stream.m_types.clear();
+  stream.m_sections.clear();
+  stream.m_addends.clear();
+
+  if ( pos > size )
+  {
+    end_pos = pos;
+    return false;
+  }
+
+  uint8_t const *records = data + pos;
+  size_t available = (size - pos) / REL_ENTRY_SIZE;
+  size_t count = find_rel_end(records, available);
+  if ( count == available )
+  {
+    end_pos = pos + available*REL_ENTRY_SIZE;
+    return false;
+  }
+
+  stream.m_offsets.resize(count);
+  stream.m_types.resize(count);
+  stream.m_sections.resize(count);
+  stream.m_addends.resize(count);
+
+  // Straight transpose of the record views
+  rel_entry const *entries = reinterpret_cast<rel_entry const *>(records);
+  for ( size_t i = 0; i < count; ++i )
+  {
+    stream.m_offsets[i]  = entries[i].offset;
+    stream.m_types[i]    = entries[i].type;
+    stream.m_sections[i] = entries[i].section;
+    stream.m_addends[i]  = entries[i].addend;
+  }
+
+  end_pos = pos + count*REL_ENTRY_SIZE;
+  return true;
+}
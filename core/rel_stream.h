@@ -0,0 +1,28 @@
+#ifndef __REL_STREAM_H__
+#define __REL_STREAM_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// One relocation list decoded to host order, one array per field.
+// The R_DOLPHIN_END terminator is not included.
+struct rel_stream
+{
+  std::vector<uint16_t> m_offsets;
+  std::vector<uint8_t>  m_types;
+  std::vector<uint8_t>  m_sections;
+  std::vector<uint32_t> m_addends;
+
+  size_t size() const
+  {
+    return m_types.size();
+  }
+};
+
+// Decodes the big endian rel_entry records starting at data[pos] up to the R_DOLPHIN_END record.
+// Returns false if the terminator is missing, with end_pos set to the first record that didn't fit.
+// stream is overwritten but keeps its capacity, so it can be reused for the next list.
+bool decode_rel_stream(uint8_t const *data, size_t size, size_t pos, rel_stream &stream, size_t &end_pos);
+
+#endif // #ifndef __REL_STREAM_H__
@@ -0,0 +1,1060 @@
+#include "rel_track.h"
+#include "module_scan.h"
+#include "rel_stream.h"
+#include <string>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <set>
+
+rel_track::rel_track()
+  : m_valid(false)
+  , m_hold_messages(false)
+  , m_counters(nullptr)
+  , m_rebase(nullptr)
+  , m_shared_demangler(nullptr)
+  , m_input_file(nullptr)
+  , m_base(START)
+  , m_next_seg_offset(START)
+  , m_internal_bss_section(0xFF)
+  , m_layout(nullptr)
+{}
+
+rel_track::rel_track(input_source &input, module_probe const *probe, bool hold_messages)
+ : m_valid(false)
+ , m_hold_messages(hold_messages)
+ , m_counters(nullptr)
+ , m_rebase(nullptr)
+ , m_shared_demangler(nullptr)
+ , m_max_filesize( static_cast<uint32_t>(input.size()) )
+ , m_input_file(&input)
+ , m_base(START)
+ , m_next_seg_offset(START)
+ , m_internal_bss_section(0xFF)
+ , m_layout(nullptr)
+{
+  {
+    load_phase_scope timer(m_timings, PHASE_READ_HEADER);
+
+    // Start from what the probe already read
+    if ( probe != nullptr && probe->m_file_size == input.size() )
+      m_image.assign(probe->m_head, probe->m_head + probe->m_head_size);
+
+    // Read full header
+    if (!this->read_header())
+    {
+      this->fail("REL: Failed to read the header");
+      return;
+    }
+
+    // Validate header information
+    if (!this->validate_header())
+    {
+      this->fail("REL: Failed simple header validation");
+      return;
+    }
+  }
+
+  // Read sections
+  load_phase_scope timer(m_timings, PHASE_READ_SECTIONS);
+  if (!this->read_sections())
+  {
+    this->fail("REL: Unable to read all sections");
+    return;
+  }
+
+  m_valid = true;
+}
+
+bool rel_track::load_image(uint32_t size)
+{
+  // Extend the in-memory image up to the requested size with a single read
+  if ( size > m_max_filesize || m_input_file == nullptr )
+    return size <= m_image.size();
+
+  size_t have = m_image.size();
+  if ( size <= have )
+    return true;
+
+  m_image.resize(size);
+  if ( !m_input_file->read(have, &m_image[have], size - have) )
+  {
+    m_image.resize(have);
+    return false;
+  }
+  return true;
+}
+
+bool rel_track::read_header()
+{
+  // Read header data from input
+  if ( !this->load_image(sizeof(relhdr)) )
+    return this->fail("REL: header is too short or inaccessible");
+
+  // The header is decoded straight from the image
+  relhdr const *hdr = be_view<relhdr>(&m_image[0], m_image.size());
+
+  m_id              = hdr->info.id;
+  m_num_sections    = hdr->info.num_sections;
+  m_section_offset  = hdr->info.section_offset;
+  m_version         = hdr->info.version;
+  m_bss_size        = hdr->bss_size;
+  m_rel_offset      = hdr->rel_offset;
+  m_import_offset   = hdr->import_offset;
+  m_import_size     = hdr->import_size;
+
+  m_prolog_prep.m_section_id      = hdr->prolog_section;
+  m_epilog_prep.m_section_id      = hdr->epilog_section;
+  m_unresolved_prep.m_section_id  = hdr->unresolved_section;
+  m_bss_section_ign               = hdr->bss_section;
+
+  m_prolog_prep.m_offset      = hdr->prolog_offset;
+  m_epilog_prep.m_offset      = hdr->epilog_offset;
+  m_unresolved_prep.m_offset  = hdr->unresolved_offset;
+
+  // Fields added by later versions
+  m_align     = m_version >= 2 ? hdr->align.get() : 0;
+  m_bss_align = m_version >= 2 ? hdr->bss_align.get() : 0;
+  m_fix_size  = m_version >= 3 ? hdr->fix_size.get() : 0;
+
+  return true;
+}
+
+bool rel_track::read_sections()
+{
+  // Pull in the section table, validate_header has already bounds checked it
+  if ( !this->load_image(m_section_offset + m_num_sections*sizeof(section_entry_be)) )
+    return this->fail("REL: Failed to read the section table");
+
+  // Read each section
+  section_entry_be const *table = be_view<section_entry_be>(&m_image[0], m_image.size(), m_section_offset);
+  if ( table == nullptr || m_section_offset + static_cast<uint64_t>(m_num_sections)*sizeof(section_entry_be) > m_image.size() )
+    return this->fail("REL: Failed to read the section table");
+  for (unsigned i = 0; i < m_num_sections; ++i)
+  {
+    // read an entry
+    section_entry entry;
+    entry.file_offset = table[i].file_offset;
+    entry.size        = table[i].size;
+
+    if (entry.file_offset == 0 && entry.size != 0)   // bss
+    {
+      if ( entry.size != m_bss_size)
+        return this->fail("BSS section size does not match (%u predicted vs %u declared)", entry.size, m_bss_size);
+    }
+    else if (entry.file_offset != 0 && entry.size != 0)  // valid
+    {
+      // Verify boundary
+      if (!verify_section(entry.file_offset, entry.size))
+        return this->fail("REL: Section is out of bounds");
+    }
+    m_sections.emplace_back(entry);
+  }
+  return true;
+}
+
+bool rel_track::validate_header() const
+{
+  // Check version first, it decides the size of the header
+  if (m_version <= 0 || m_version > 3)
+    return this->fail("REL: Unknown version (%u)", m_version);
+
+  // Check for absurd amount of sections
+  if (m_num_sections > REL_MAX_SECTIONS || m_num_sections <= 1)
+    return this->fail("REL: Unlikely number of sections (%u)", m_num_sections);
+
+  // Check section boundary
+  if (!verify_section(m_section_offset, m_num_sections*sizeof(section_entry_be)) )
+    return this->fail("REL: Section has overlapping or out of bounds offset (%u entries)", m_num_sections);
+
+  return true;
+}
+
+bool rel_track::verify_section(uint32_t offset, uint32_t size) const
+{
+  offset = SECTION_OFF(offset);
+  return rel_header_size(m_version) <= offset && static_cast<uint64_t>(offset) + size <= m_max_filesize;
+}
+
+bool rel_track::is_good() const
+{
+  return m_valid;
+}
+
+module_handle module_name_table::intern(uint32_t module_id)
+{
+  auto ins = m_handles.insert(std::make_pair(module_id, static_cast<module_handle>(m_ids.size())));
+  if ( ins.second )
+    m_ids.push_back(module_id);
+  return ins.first->second;
+}
+
+uint32_t module_name_table::module_id(module_handle handle) const
+{
+  return m_ids[handle];
+}
+
+size_t module_name_table::size() const
+{
+  return m_ids.size();
+}
+
+void module_name_table::clear()
+{
+  m_ids.clear();
+  m_handles.clear();
+}
+
+module_summary::module_summary(uint32_t id, module_placement const &placement, std::vector<section_entry> &&sections)
+  : m_id(id)
+  , m_placement(placement)
+  , m_sections(std::move(sections))
+{}
+
+module_summary::module_summary(module_summary &&other)
+  : m_id(other.m_id)
+  , m_placement(other.m_placement)
+  , m_sections(std::move(other.m_sections))
+{}
+
+module_summary &module_summary::operator =(module_summary &&other)
+{
+  m_id = other.m_id;
+  m_placement = other.m_placement;
+  m_sections = std::move(other.m_sections);
+  return *this;
+}
+
+uint32_t module_summary::id() const
+{
+  return m_id;
+}
+
+module_placement const &module_summary::placement() const
+{
+  return m_placement;
+}
+
+size_t module_summary::num_sections() const
+{
+  return m_sections.size();
+}
+
+section_entry const &module_summary::section(size_t index) const
+{
+  return m_sections[index];
+}
+
+std::vector<section_entry> const &module_summary::sections() const
+{
+  return m_sections;
+}
+
+/*section_entry const * rel_track::get_section(uint entry_id) const
+{
+  if (entry_id < m_sections.size())
+    return &m_sections[entry_id];
+
+  rel_msg("Attempted to retrieve an invalid section (#%u)", entry_id);
+  qexit(1);
+  return nullptr;
+}*/
+
+uint32_t rel_track::section_address(uint8_t section, uint32_t offset) const
+{
+  auto it = m_segment_address_map.find(section);
+  if ( it == m_segment_address_map.end() )
+    return 0xFFFFFFFF;
+  return it->second + offset;
+}
+
+void rel_track::set_base(uint32_t base)
+{
+  m_base = base;
+}
+
+void rel_track::set_sibling_modules(std::vector<std::string> const &files, std::string const &index_path)
+{
+  m_sibling_files = files;
+  m_index_path = index_path;
+}
+
+uint32_t rel_track::end_address() const
+{
+  return m_next_seg_offset;
+}
+
+load_timings const &rel_track::timings() const
+{
+  return m_timings;
+}
+
+load_diagnostics const &rel_track::diagnostics() const
+{
+  return m_diagnostics;
+}
+
+std::vector<std::string> const &rel_track::held_messages() const
+{
+  return m_messages;
+}
+
+void rel_track::print_messages()
+{
+  for ( auto it = m_messages.begin(); it != m_messages.end(); ++it )
+    rel_msg("%s\n", it->c_str());
+  m_messages.clear();
+}
+
+bool rel_track::fail(char const *format, ...) const
+{
+  char message[256];
+  va_list va;
+  va_start(va, format);
+  vsnprintf(message, sizeof(message), format, va);
+  va_end(va);
+  message[sizeof(message) - 1] = '\0';
+
+  if ( m_hold_messages )
+    m_messages.push_back(message);
+  else
+    rel_msg("%s\n", message);
+  return false;
+}
+
+void rel_track::set_counters(load_counters *counters)
+{
+  m_counters = counters;
+}
+
+void rel_track::set_rebase_table(rebase_table *table)
+{
+  m_rebase = table;
+}
+
+void rel_track::set_demangle_cache(demangle_cache *cache)
+{
+  m_shared_demangler = cache;
+}
+
+demangle_cache &rel_track::demangler()
+{
+  return m_shared_demangler != nullptr ? *m_shared_demangler : m_demangler;
+}
+
+bool rel_track::apply_patches(image_sink &sink)
+{
+  // The header fields are unset or stale if the constructor failed
+  if ( !m_valid )
+    return this->fail("REL: The module was not read, nothing to load");
+
+  m_diagnostics.clear();
+  bool ok = this->apply_steps(sink);
+
+  // Whatever went wrong along the way, once
+  m_diagnostics.summarize("REL");
+  return ok;
+}
+
+bool rel_track::apply_steps(image_sink &sink)
+{
+  // Everything past this point works from memory
+  if ( !this->load_image(m_max_filesize) )
+    return this->fail("REL: Failed to read the file into memory");
+
+  this->layout_sections();
+  if ( !this->create_sections(sink) )
+    return this->fail("Creating sections failed");
+
+  if ( !this->apply_relocations(sink) )
+    return this->fail("Relocations failed");
+
+  // TODO: Create Imports
+
+  // TODO: Assign function names
+  if ( !this->apply_names(sink) )
+    return this->fail("Naming failed");
+
+  return true;
+}
+
+bool rel_track::load_all()
+{
+  if ( !m_valid )
+    return this->fail("REL: The module was not read, nothing to load");
+  if ( !this->load_image(m_max_filesize) )
+    return this->fail("REL: Failed to read the file into memory");
+  m_input_file = nullptr;
+  return true;
+}
+
+uint32_t rel_track::id() const
+{
+  return m_id;
+}
+
+size_t rel_track::num_sections() const
+{
+  return m_sections.size();
+}
+
+uint32_t rel_track::place(uint32_t base)
+{
+  m_base = base;
+  this->layout_sections();
+  return m_next_seg_offset;
+}
+
+bool rel_track::link_relocations(module_layout const &layout)
+{
+  m_diagnostics.clear();
+  m_layout = &layout;
+  if ( !this->load_image(m_max_filesize) )
+    return this->fail("REL: Failed to read the file into memory");
+  return this->compile_relocations();
+}
+
+bool rel_track::write_linked(image_sink &sink)
+{
+  if ( !this->create_sections(sink) )
+    return this->fail("Creating sections failed");
+
+  if ( !this->write_imports(sink) )
+    return this->fail("Relocations failed");
+
+  if ( !this->apply_names(sink) )
+    return this->fail("Naming failed");
+
+  return true;
+}
+
+module_placement rel_track::placement() const
+{
+  module_placement placement = { m_version, m_align, m_bss_align, m_fix_size, m_max_filesize };
+  return placement;
+}
+
+void rel_track::layout_sections()
+{
+  m_segment_address_map.clear();
+  m_internal_bss_section = 0xFF;
+
+  std::vector<uint32_t> addresses(m_sections.size());
+  m_next_seg_offset = place_module_sections(this->placement(), m_sections.data(), m_sections.size(), m_base, addresses.data());
+  for ( size_t i = 0; i < m_sections.size(); ++i )
+  {
+    if ( addresses[i] == REL_NO_ADDRESS )
+      continue;
+
+    if ( SECTION_OFF(m_sections[i].file_offset) == 0 )
+      m_internal_bss_section = static_cast<uint8_t>(i);
+    m_segment_address_map[static_cast<uint8_t>(i)] = addresses[i];
+  }
+}
+
+bool rel_track::create_sections(image_sink &sink)
+{
+  load_phase_scope timer(m_timings, PHASE_CREATE_SECTIONS);
+
+  // Create sections
+  for (size_t i = 0; i < m_sections.size(); ++i)
+  {
+    auto & entry = m_sections[i];
+
+    // Skip unused
+    if ( entry.file_offset == 0 && entry.size == 0 )
+      continue;
+
+    std::string type = (entry.file_offset & SECTION_EXEC) ? CLASS_CODE : CLASS_DATA;
+    std::string name = (entry.file_offset & SECTION_EXEC) ? NAME_CODE : NAME_DATA;
+    name += std::to_string(static_cast<unsigned long long>(i));
+
+    uint32_t address = this->section_address(static_cast<uint8_t>(i));
+    uint32_t foffset = SECTION_OFF(entry.file_offset);
+
+    // Create the segment
+    if ( foffset != 0 )  // known segment
+    {
+      //if ( foffset < m_next_seg_offset )
+        //return err_msg("Segments are not linear (seg #%u)", i);
+
+      if (!sink.add_segment(address, address + entry.size, name.c_str(), type.c_str()))
+        return this->fail("Failed to create segment #%u", i);
+
+      uint64_t file_offset = m_input_file != nullptr ? m_input_file->file_offset(foffset) : NO_FILE_OFFSET;
+      if (!sink.load_bytes(address, &m_image[foffset], entry.size, file_offset))
+        return this->fail("Failed to pull data from file (segment #%u)", i);
+    }
+    else  // .bss section
+    {
+      if (!sink.add_segment(address, address + entry.size, NAME_BSS, CLASS_BSS))
+        return this->fail("Failed to create BSS segment #%u", i);
+    }
+  }
+  return true;
+}
+
+void rel_track::load_section_data()
+{
+  m_section_data.clear();
+  m_section_data.resize(m_sections.size());
+  for ( size_t i = 0; i < m_sections.size(); ++i )
+  {
+    uint32_t foffset = SECTION_OFF(m_sections[i].file_offset);
+    if ( foffset != 0 && m_sections[i].size != 0 )
+      m_section_data[i].assign(m_image.begin() + foffset, m_image.begin() + foffset + m_sections[i].size);
+  }
+
+  // Index the copies and the section addresses for the relocation kernels
+  if ( m_rebase != nullptr )
+    m_rebase->clear();
+  m_patch_image.clear(&m_diagnostics, m_rebase);
+  for ( size_t i = 0; i < m_section_data.size(); ++i )
+  {
+    std::vector<uint8_t> &data = m_section_data[i];
+    m_patch_image.set_section(static_cast<uint8_t>(i), this->section_address(static_cast<uint8_t>(i)),
+      data.empty() ? nullptr : &data[0], static_cast<uint32_t>(data.size()));
+  }
+}
+
+void rel_track::commit_section_data(image_sink &sink)
+{
+  // Patching keeps the file bytes as the originals, so the patched bytes view still works
+  for ( size_t i = 0; i < m_section_data.size(); ++i )
+  {
+    if ( !m_section_data[i].empty() )
+      sink.patch_bytes(this->section_address(static_cast<uint8_t>(i)), &m_section_data[i][0], m_section_data[i].size());
+  }
+}
+
+bool rel_track::apply_relocations(image_sink &sink)
+{
+  if ( !this->compile_relocations() )
+    return false;
+
+  // The XTRN segment follows the sections
+  this->place_imports(m_next_seg_offset);
+  return this->write_imports(sink);
+}
+
+bool rel_track::compile_relocations()
+{
+  {
+    load_phase_scope timer(m_timings, PHASE_INIT_RESOLVERS);
+    this->init_resolvers(); // initialize user-names
+  }
+
+  m_slots.clear();
+  m_patches.clear();
+  m_import_modules.clear();
+
+  // Apply relocations
+  if (m_import_offset > 0)
+  {
+    uint32_t count = m_import_size / sizeof(import_entry);
+    std::vector< std::unordered_map<uint32_t, uint32_t> > slot_lookup;   // by module_handle, key -> slot
+    rel_stream stream;
+
+    {
+      load_phase_scope timer(m_timings, PHASE_SECTION_DATA);
+      this->load_section_data();
+    }
+
+    import_entry const *imports = be_view<import_entry>(&m_image[0], m_image.size(), m_import_offset);
+    for (unsigned i = 0; i < count; ++i)
+    {
+      // Get the entry
+      if ( imports == nullptr || m_import_offset + static_cast<uint64_t>(i + 1)*sizeof(import_entry) > m_image.size() )
+        return this->fail("REL: Failed to read relocation data %u", i);
+      uint32_t module_id = imports[i].id;
+      uint32_t rel_start = imports[i].offset;
+      load_phase_scope timer(m_timings, module_id == m_id ? PHASE_SELF_RELOCATIONS : PHASE_EXTERNAL_RELOCATIONS);
+
+      // Decode the whole relocation list up to its terminator
+      if ( rel_start > m_image.size() )
+        return this->fail("REL: Relocation data for import %u is out of bounds (%08X)", i, rel_start);
+
+      size_t end_pos = 0;
+      if ( !decode_rel_stream(&m_image[0], m_image.size(), rel_start, stream, end_pos) )
+      {
+        if ( module_id == m_id )
+          return this->fail("REL: Failed to read relocation operation @0x%08X", static_cast<uint32_t>(end_pos));
+        return this->fail("REL: Failed to read relocation operation @0x%08X, id %u", static_cast<uint32_t>(end_pos), module_id);
+      }
+
+      uint16_t const *rel_offsets = stream.size() ? &stream.m_offsets[0] : nullptr;
+      uint8_t const *rel_types = stream.size() ? &stream.m_types[0] : nullptr;
+      uint8_t const *rel_sections = stream.size() ? &stream.m_sections[0] : nullptr;
+      uint32_t const *rel_addends = stream.size() ? &stream.m_addends[0] : nullptr;
+
+      if ( m_counters != nullptr )
+      {
+        for (size_t r = 0; r < stream.size(); ++r)
+          ++m_counters->m_relocations[rel_types[r]];
+        m_counters->m_module_relocations[module_id] += stream.size();
+      }
+
+      uint8_t current_section = 0;
+      uint32_t current_offset = 0;
+
+      // Self-relocations, every type goes through its kernel
+      if ( module_id == m_id )
+      {
+        for (size_t r = 0; r < stream.size(); ++r)
+        {
+          uint8_t rel_type = rel_types[r];
+          uint8_t rel_section = rel_sections[r];
+
+          // R_DOLPHIN_SECTION starts over in a section, everything else moves on by its offset
+          bool to_section = rel_type == R_DOLPHIN_SECTION;
+          current_offset = to_section ? 0 : current_offset + rel_offsets[r];
+          current_section = to_section ? rel_section : current_section;
+
+          m_patch_image.apply(rel_type, current_section, current_offset, m_patch_image.address(rel_section, rel_addends[r]));
+        }
+      }
+      else // EXTERNALS
+      {
+        // Sections of the module if it is linked into the same image
+        uint32_t const *linked = m_layout != nullptr ? m_layout->sections(module_id) : nullptr;
+
+        // Retrieve the module handle
+        module_handle imp_module = m_import_modules.intern(module_id);
+        if ( imp_module >= slot_lookup.size() )
+          slot_lookup.resize(imp_module + 1);
+
+        // Compile the relocations against deduplicated import slots
+        for (size_t r = 0; r < stream.size(); ++r)
+        {
+          uint8_t rel_type = rel_types[r];
+          uint8_t rel_section = rel_sections[r];
+          uint32_t rel_addend = rel_addends[r];
+
+          current_offset += rel_offsets[r];
+          if ( rel_type == R_DOLPHIN_SECTION )
+          {
+            current_section = rel_section;
+            current_offset  = 0;
+            continue;
+          }
+
+          // Only relocations that patch something get an import slot
+          rel_kind const &kind = rel_kinds[rel_type];
+          if ( (kind.m_flags & REL_KIND_PATCH) == 0 )
+          {
+            if ( (kind.m_flags & REL_KIND_KNOWN) == 0 )
+              m_diagnostics.report(DIAG_UNKNOWN_RELOCATION, "type %u at section %u offset 0x%X, import from %u", rel_type, current_section, current_offset, module_id);
+            continue;
+          }
+
+          // A linked module is patched to directly, without an import slot
+          if ( linked != nullptr && linked[rel_section] != REL_NO_ADDRESS )
+          {
+            m_patch_image.apply(rel_type, current_section, current_offset, linked[rel_section] + rel_addend);
+            continue;
+          }
+
+          // Try to get a unique key for the module offset
+          uint32_t offs = this->get_external_offset(module_id, rel_addend, rel_section);
+          if ( offs == 0 || offs == 1 )
+            offs = rel_addend + 0x1000000 * rel_section;
+
+          // If the key doesn't exist, then allocate the next import slot
+          auto ins = slot_lookup[imp_module].insert( std::make_pair(offs, static_cast<uint32_t>(m_slots.size())) );
+          if ( ins.second )
+          {
+            import_slot slot;
+            slot.m_module  = imp_module;
+            slot.m_section = rel_section;
+            slot.m_addend  = rel_addend;
+            slot.m_virtual = this->get_external_offset(module_id, rel_addend, rel_section, true);
+            m_slots.push_back(slot);
+          }
+
+          import_patch patch;
+          patch.m_section = current_section;
+          patch.m_offset  = current_offset;
+          patch.m_type    = rel_type;
+          patch.m_slot    = ins.first->second;
+          m_patches.push_back(patch);
+        }
+      }
+    } // for each module
+  }
+  return true;
+}
+
+uint32_t rel_track::place_imports(uint32_t address)
+{
+  if ( m_import_offset == 0 )
+    return address;
+
+  load_phase_scope timer(m_timings, PHASE_EXTERNAL_RELOCATIONS);
+
+  // Now place the import/externals section
+  uint32_t desired_import_size = static_cast<uint32_t>(m_slots.size() * 4);
+  m_segment_address_map[SECTION_IMPORTS] = address;
+  //section_entry import_section = { m_next_section_offset, desired_import_size };
+  m_next_seg_offset = address + desired_import_size;
+
+  // Execute the plan, import slots hold the addend and are written with the sections
+  m_import_data.assign(desired_import_size, 0);
+  for ( auto e = m_patches.begin(); e != m_patches.end(); ++e )
+  {
+    uint32_t targ_offset = address + e->m_slot*4;
+    m_patch_image.apply(e->m_type, e->m_section, e->m_offset, targ_offset);
+
+    // Branches land on the slot itself, everything else reads the addend from it
+    if ( (rel_kinds[e->m_type].m_flags & REL_KIND_RELATIVE) == 0 )
+      store_be32(&m_import_data[e->m_slot*4], m_slots[e->m_slot].m_addend);
+  }
+  return m_next_seg_offset;
+}
+
+bool rel_track::write_imports(image_sink &sink)
+{
+  if ( m_import_offset == 0 )
+    return true;
+
+  load_phase_scope timer(m_timings, PHASE_EXTERNAL_RELOCATIONS);
+
+  // Now create the import/externals section, a linked module may not need one
+  uint32_t imp_offset = this->section_address(SECTION_IMPORTS);
+  uint32_t desired_import_size = static_cast<uint32_t>(m_import_data.size());
+  if ( m_layout == nullptr || desired_import_size != 0 )
+  {
+    if (!sink.add_segment(imp_offset, imp_offset + desired_import_size, NAME_EXTERN, CLASS_EXTERN))
+      return this->fail("Failed to create XTRN segment");
+  }
+
+  m_import_section = static_cast<uint8_t>(m_sections.size());
+  //m_sections.emplace_back(import_section);
+
+  // Name and describe each import slot once
+  std::vector<char const *> module_names(m_import_modules.size(), static_cast<char const *>(nullptr));
+  demangle_cache &demangler = this->demangler();
+  char comment[96];
+  for ( uint32_t i = 0; i < m_slots.size(); ++i )
+  {
+    import_slot const &slot = m_slots[i];
+    uint32_t targ_offset = imp_offset + i*4;
+    uint32_t module_id = m_import_modules.module_id(slot.m_module);
+
+    // Add comment for module at its first slot
+    char const *&module_name = module_names[slot.m_module];
+    if ( module_name == nullptr )
+    {
+      module_name = this->module_name(module_id);
+      sink.add_comment( targ_offset, buf_format(comment, sizeof(comment), "\nImports from %s\n", module_name) );
+    }
+
+    // Name the import, built in place in the pool
+    m_names.begin();
+    m_names.append(module_name);
+
+    if ( slot.m_virtual == 0 )
+    {
+      if ( strcmp(module_name, BASENAME) != 0 )
+      {
+        m_names.append("_s");
+        m_names.append_dec(slot.m_section);
+        m_names.append_char('_');
+      }
+      m_names.append_hex(slot.m_addend);
+      sink.add_comment(targ_offset, buf_format(comment, sizeof(comment), "addend: %08X; section: %u;", slot.m_addend, static_cast<unsigned>(slot.m_section)));
+    }
+    else if ( slot.m_virtual == 1 )
+    {
+      m_names.append("_s");
+      m_names.append_dec(slot.m_section);
+      m_names.append("_bss_");
+      m_names.append_hex(slot.m_addend);
+      sink.add_comment(targ_offset, buf_format(comment, sizeof(comment), "addend: %08X; section: %u (BSS);", slot.m_addend, static_cast<unsigned>(slot.m_section)));
+    }
+    else
+    {
+      m_names.append_char('_');
+      m_names.append_hex(slot.m_virtual);
+      sink.add_comment(targ_offset, buf_format(comment, sizeof(comment), "addend: %08X; section: %u; virtual: 0x%08X;", slot.m_addend, static_cast<unsigned>(slot.m_section), slot.m_virtual));
+    }
+
+    // A linker map of the module has the real name, the one being built is dropped then
+    char const *symbol = this->module_symbols(module_id).find(slot.m_section, slot.m_addend);
+    sink.set_name(targ_offset, symbol != nullptr ? symbol : m_names.end());
+    if ( symbol != nullptr && (symbol = demangler.demangle(symbol)) != nullptr )
+      sink.add_comment(targ_offset, symbol);
+  }
+
+  // Write everything back
+  this->commit_section_data(sink);
+  if ( !m_import_data.empty() )
+    sink.put_bytes(imp_offset, &m_import_data[0], m_import_data.size());
+  return true;
+}
+
+bool rel_track::apply_names(image_sink &sink)
+{
+  load_phase_scope timer(m_timings, PHASE_APPLY_NAMES);
+  // Describe the binary header
+  sink.add_program_comment(str_format("ID: %u", m_id).c_str());
+  sink.add_program_comment(str_format("Version: %u", m_version).c_str());
+  sink.add_program_comment(str_format("%u sections @ %08X:", m_num_sections, m_section_offset).c_str());
+  for ( unsigned i = 0; i < m_sections.size(); ++i )
+  {
+    if ( i == m_internal_bss_section )
+    {
+      sink.add_program_comment(str_format("    .bss%u: %u bytes", i, m_sections[i].size).c_str());
+    }
+    else if ( m_sections[i].file_offset != 0 )
+    {
+      if ( m_sections[i].file_offset & SECTION_EXEC )
+        sink.add_program_comment(str_format("    .text%u: %u bytes @ %08X", i, m_sections[i].size, SECTION_OFF(m_sections[i].file_offset)).c_str());
+      else
+        sink.add_program_comment(str_format("    .data%u: %u bytes @ %08X", i, m_sections[i].size, SECTION_OFF(m_sections[i].file_offset)).c_str());
+    }
+  }
+  sink.add_program_comment(str_format("Imports: %u bytes @ %08X", m_import_size, m_import_offset).c_str());
+  sink.add_program_comment(str_format("Relocations @ %08X", m_rel_offset).c_str());
+
+  // Name everything the module's own map knows about
+  symbol_map const &symbols = this->module_symbols(m_id);
+  demangle_cache &demangler = this->demangler();
+  for ( size_t i = 0; i < symbols.size(); ++i )
+  {
+    map_symbol const &symbol = symbols.symbol(i);
+    if ( symbol.m_section >= m_sections.size() || symbol.m_offset >= m_sections[symbol.m_section].size )
+      continue;
+
+    uint32_t addr = this->section_address(symbol.m_section, symbol.m_offset);
+    sink.set_name(addr, symbols.name(symbol));
+    if ( char const *demangled = demangler.demangle(symbols.name(symbol)) )
+      sink.add_comment(addr, demangled);
+  }
+
+  // Obtain addresses
+  uint32_t epilog_addr = section_address(m_epilog_prep.m_section_id, m_epilog_prep.m_offset);
+  uint32_t prolog_addr = section_address(m_prolog_prep.m_section_id, m_prolog_prep.m_offset);
+  uint32_t unresolved_addr = section_address(m_unresolved_prep.m_section_id, m_unresolved_prep.m_offset);
+
+  // Make function exports, a linked load has them once per module
+  std::string prefix = m_layout != nullptr ? this->module_name(m_id) : "";
+  sink.add_export(epilog_addr, (prefix + "_epilog").c_str());
+  sink.add_export(prolog_addr, (prefix + "_prolog").c_str());
+  sink.add_export(unresolved_addr, (prefix + "_unresolved").c_str());
+
+  return true;
+}
+
+void rel_track::init_resolvers()
+{
+  // Headers are only read for files the index doesn't know about
+  std::vector<std::string> files(m_sibling_files);
+  module_index index;
+  if ( !m_index_path.empty() )
+    index.load(m_index_path.c_str());
+
+  // Sort so the scan and any duplicate ids resolve the same way on every run
+  std::sort(files.begin(), files.end());
+
+  std::vector<std::string> keys, pending;
+  std::vector<module_index_entry> pending_entries;
+  m_map_dirs.clear();
+  m_symbol_maps.clear();
+  for ( auto it = files.begin(); it != files.end(); ++it )
+  {
+    std::string basename(file_basename(*it));
+    std::string key(module_index_key(*it, m_index_path));
+    keys.push_back(key);
+
+    // Linker maps are looked for in every directory the modules come from
+    std::string dir(it->substr(0, it->size() - basename.size()));
+    if ( std::find(m_map_dirs.begin(), m_map_dirs.end(), dir) == m_map_dirs.end() )
+      m_map_dirs.push_back(dir);
+
+    uint64_t size = 0, mtime = 0;
+    if ( !get_file_stamp(it->c_str(), size, mtime) )
+      continue;
+
+    if ( index.find(key, size, mtime) != nullptr )
+      continue;
+
+    // New or changed, queue the header for parsing
+    module_index_entry entry = module_index_entry();
+    entry.m_file_size = size;
+    entry.m_file_mtime = mtime;
+    pending.push_back(*it);
+    pending_entries.push_back(entry);
+  }
+
+  // A linked load has no siblings, its maps are next to the linked modules
+  if ( m_layout != nullptr )
+  {
+    std::vector<std::string> const &dirs = m_layout->map_dirs();
+    for ( auto dir = dirs.begin(); dir != dirs.end(); ++dir )
+    {
+      if ( std::find(m_map_dirs.begin(), m_map_dirs.end(), *dir) == m_map_dirs.end() )
+        m_map_dirs.push_back(*dir);
+    }
+  }
+
+  // Parse the queued headers concurrently, then merge in file name order
+  scan_module_files(pending, pending_entries);
+  for ( size_t i = 0; i < pending.size(); ++i )
+    index.update(module_index_key(pending[i], m_index_path), pending_entries[i]);
+
+  index.retain(keys);
+
+  if ( !m_index_path.empty() && index.is_dirty() && !index.save(m_index_path.c_str()) )
+    this->fail("REL: Unable to write the module index %s", m_index_path.c_str());
+
+  // Load the module names, a duplicate id resolves to the last module by path and archive order
+  m_module_names.clear();
+  std::map<uint32_t, module_info const *> modules_by_id;
+  auto const &entries = index.entries();
+  for ( auto it = entries.begin(); it != entries.end(); ++it )
+  {
+    auto const &modules = it->second.m_modules;
+    for ( auto m = modules.begin(); m != modules.end(); ++m )
+    {
+      if ( m->m_id == 0 )
+        m_diagnostics.report(DIAG_MODULE_ID_ZERO, "%s%s%s", it->first.c_str(), m->m_member.empty() ? "" : ":", m->m_member.c_str());
+      m_module_names[m->m_id] = m_names.intern(m->m_name.c_str());
+      modules_by_id[m->m_id] = &*m;
+    }
+  }
+
+  // Keep just the section tables, in id order for lookups
+  m_external_modules.clear();
+  m_external_modules.reserve(modules_by_id.size());
+  for ( auto it = modules_by_id.begin(); it != modules_by_id.end(); ++it )
+  {
+    std::vector<section_entry> sections(it->second->m_sections);
+    m_external_modules.push_back(module_summary(it->first, it->second->m_placement, std::move(sections)));
+  }
+  this->build_resolve_tables();
+
+  /*std::ifstream modid(path + "/module_id.txt");
+  while( modid >> id >> name )
+    m_module_names[id] = name;*/
+}
+
+char const *rel_track::known_module_name(uint32_t module_id) const
+{
+  auto it = m_module_names.find(module_id);
+  if ( it != m_module_names.end() )
+    return it->second;
+  return m_layout != nullptr ? m_layout->name(module_id) : nullptr;
+}
+
+char const *rel_track::module_name(uint32_t module_id)
+{
+  if ( char const *name = this->known_module_name(module_id) )
+    return name;
+  else if ( module_id == 0 )
+    return BASENAME;
+
+  m_names.begin();
+  m_names.append("module");
+  m_names.append_dec(module_id);
+  return m_names.end();
+}
+
+symbol_map const &rel_track::module_symbols(uint32_t module_id)
+{
+  auto it = m_symbol_maps.find(module_id);
+  if ( it != m_symbol_maps.end() )
+    return it->second;
+
+  symbol_map &symbols = m_symbol_maps[module_id];
+  char const *name = this->known_module_name(module_id);
+  if ( module_id != 0 && name == nullptr )
+    return symbols;
+
+  // The base's symbols are absolute, which is also how imports from it are addressed (section 0)
+  std::string map_name(module_id == 0 ? "main.map" : std::string(name) + ".map");
+  bool loaded = false;
+  for ( auto dir = m_map_dirs.begin(); dir != m_map_dirs.end() && !loaded; ++dir )
+    loaded = symbols.load((*dir + map_name).c_str(), module_id == 0);
+  if ( !loaded || module_id == 0 )
+    return symbols;
+
+  // A module's map numbers its sections on its own, tie them to the module's section table
+  std::vector<section_entry> const *sections = module_id == m_id ? &m_sections : nullptr;
+  for ( auto it = m_external_modules.begin(); it != m_external_modules.end() && sections == nullptr; ++it )
+  {
+    if ( it->id() == module_id )
+      sections = &it->sections();
+  }
+  bool matched = sections != nullptr ? symbols.match_sections(sections->data(), sections->size())
+                                     : symbols.match_sections(nullptr, 0);
+  if ( !matched )
+    m_diagnostics.report(DIAG_MAP_SECTION_MISMATCH, "%s", map_name.c_str());
+  return symbols;
+}
+
+void rel_track::build_resolve_tables()
+{
+  m_resolve_rows.clear();
+  m_resolve_sections.clear();
+
+  uint32_t max_id = 0;
+  for ( auto it = m_external_modules.begin(); it != m_external_modules.end(); ++it )
+  {
+    if ( it->id() <= MAX_RESOLVED_MODULE_ID )
+      max_id = std::max(max_id, it->id());
+    else
+      m_diagnostics.report(DIAG_MODULE_ID_TOO_LARGE, "module %u", it->id());
+  }
+
+  resolved_section missing = { 0, 0, RESOLVE_MISSING };
+  m_resolve_rows.assign(m_external_modules.empty() ? 0 : max_id + 1, 0);
+  m_resolve_sections.assign(REL_MAX_SECTIONS, missing);
+
+  for ( auto it = m_external_modules.begin(); it != m_external_modules.end(); ++it )
+  {
+    if ( it->id() > MAX_RESOLVED_MODULE_ID )
+      continue;
+
+    // Where the sections would be with the module loaded at START on its own
+    uint32_t addresses[REL_MAX_SECTIONS];
+    place_module_sections(it->placement(), it->sections().data(), it->num_sections(), START, addresses);
+
+    m_resolve_rows[it->id()] = static_cast<uint32_t>(m_resolve_sections.size() / REL_MAX_SECTIONS);
+    for ( unsigned i = 0; i < REL_MAX_SECTIONS; ++i )
+    {
+      resolved_section res = { 0, 0, RESOLVE_BAD_SECTION };
+      if ( i < it->num_sections() )
+      {
+        res.m_file_base = SECTION_OFF(it->section(i).file_offset);
+        res.m_virt_base = addresses[i];
+        res.m_state = res.m_file_base == 0 ? RESOLVE_BSS : RESOLVE_FOUND;
+      }
+      m_resolve_sections.push_back(res);
+    }
+  }
+}
+
+uint32_t rel_track::get_external_offset(uint32_t module_id, uint32_t offset, uint8_t section, bool virt) const
+{
+  uint32_t row = module_id < m_resolve_rows.size() ? m_resolve_rows[module_id] : 0;
+  if ( section >= REL_MAX_SECTIONS )
+  {
+    if ( row != 0 )
+      m_diagnostics.report(DIAG_INVALID_SECTION_REFERENCE, "module %u section %u", module_id, static_cast<unsigned int>(section));
+    return 0;
+  }
+
+  resolved_section const &res = m_resolve_sections[row*REL_MAX_SECTIONS + section];
+  switch ( res.m_state )
+  {
+  case RESOLVE_FOUND:
+    return (virt ? res.m_virt_base : res.m_file_base) + offset;
+  case RESOLVE_BSS:
+    return 1;
+  case RESOLVE_BAD_SECTION:
+    m_diagnostics.report(DIAG_INVALID_SECTION_REFERENCE, "module %u section %u", module_id, static_cast<unsigned int>(section));
+    return 0;
+  default:
+    return 0;
+  }
+}
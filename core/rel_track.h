@@ -0,0 +1,286 @@
+#ifndef __REL_TRACK_H__
+#define __REL_TRACK_H__
+
+#include "rel.h"
+#include "rel_kernels.h"
+#include "diagnostics.h"
+#include "input_source.h"
+#include "image_sink.h"
+#include "module_index.h"
+#include "load_timer.h"
+#include "load_stats.h"
+#include "symbol_map.h"
+#include "demangle.h"
+#include "string_pool.h"
+#include "module_layout.h"
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+#define BASENAME "_BASE_"
+
+struct fxn_naming_entry
+{
+  uint32_t m_offset;
+  uint8_t  m_section_id;
+};
+
+#define SECTION_IMPORTS 99
+
+struct module_probe;
+
+// Immutable section table of an external module, all that is needed to resolve imports into it.
+// Move-only so the tables are never duplicated by accident.
+class module_summary
+{
+public:
+  module_summary(uint32_t id, module_placement const &placement, std::vector<section_entry> &&sections);
+  module_summary(module_summary &&other);
+  module_summary &operator =(module_summary &&other);
+
+  uint32_t id() const;
+  module_placement const &placement() const;
+  size_t num_sections() const;
+  section_entry const &section(size_t index) const;
+  std::vector<section_entry> const &sections() const;
+
+private:
+  module_summary(module_summary const &);
+  module_summary &operator =(module_summary const &);
+
+  uint32_t m_id;
+  module_placement m_placement;
+  std::vector<section_entry> m_sections;
+};
+
+typedef uint32_t module_handle;
+
+// Interns the modules referenced by the import table as small dense handles, in first-seen order.
+// Modules are identified by id, names are only materialized when something is written to the database.
+class module_name_table
+{
+public:
+  module_handle intern(uint32_t module_id);
+
+  uint32_t module_id(module_handle handle) const;
+  size_t size() const;
+  void clear();
+
+private:
+  std::vector<uint32_t> m_ids;
+  std::unordered_map<uint32_t, module_handle> m_handles;
+};
+
+// A unique imported symbol, one 4 byte slot in the XTRN segment
+struct import_slot
+{
+  module_handle m_module;
+  uint32_t m_addend;
+  uint32_t m_virtual;     // get_external_offset(virt = true) result
+  uint8_t  m_section;
+};
+
+// A compiled external relocation
+struct import_patch
+{
+  uint32_t m_offset;
+  uint32_t m_slot;
+  uint8_t  m_section;
+  uint8_t  m_type;
+};
+
+// Module ids above this are not given a row in the resolution tables
+#define MAX_RESOLVED_MODULE_ID 0xFFFF
+
+enum resolve_state
+{
+  RESOLVE_MISSING = 0,    // module is not known
+  RESOLVE_BAD_SECTION,    // module is known but has no such section
+  RESOLVE_BSS,            // section has no file data
+  RESOLVE_FOUND
+};
+
+// Precomputed bases of one section of an external module
+struct resolved_section
+{
+  uint32_t m_file_base;   // file offset of the section
+  uint32_t m_virt_base;   // address of the section when the module is loaded at START
+  uint8_t  m_state;
+};
+
+class rel_track
+{
+public:
+  rel_track();
+  // A probe from probe_module on the same input saves reading the start of the file again.
+  // Tracks made off the main thread hold their errors back for print_messages, since IDA's msg
+  // may only be called from the main thread.
+  rel_track(input_source &input, module_probe const *probe = nullptr, bool hold_messages = false);
+
+  bool is_good() const;
+
+  // Errors held back so far, and printing them on the main thread
+  std::vector<std::string> const &held_messages() const;
+  void print_messages();
+
+  // Address the module is loaded at, START by default. Version 1 modules start their first section there,
+  // later versions keep their sections at the file offsets from it, like OSLink.
+  void set_base(uint32_t base);
+
+  // Other modules to resolve imports against, and where to cache their headers (empty for no cache)
+  void set_sibling_modules(std::vector<std::string> const &files, std::string const &index_path);
+
+  // First address past everything apply_patches created
+  uint32_t end_address() const;
+
+  //section_entry const * get_section(uint entry_id) const;
+  uint32_t section_address(uint8_t section, uint32_t offset = 0) const;
+
+  bool apply_patches(image_sink &sink);
+
+  // Time spent in each phase of the load so far
+  load_timings const &timings() const;
+
+  // Problems counted by the last apply_patches
+  load_diagnostics const &diagnostics() const;
+
+  // Where to count relocations by type and module, nullptr to not count them
+  void set_counters(load_counters *counters);
+
+  // Where to record the applied relocations so the image can be moved later, nullptr to not record them
+  void set_rebase_table(rebase_table *table);
+
+  // Where demangled names are cached, so modules of one load can share them. nullptr for a cache of
+  // the track's own, either way it lasts no longer than the load.
+  void set_demangle_cache(demangle_cache *cache);
+
+  // A linked load (see game_link) runs apply_patches in steps, everything up to write_linked
+  // leaves the sink alone and can run on any thread.
+
+  // Reads the rest of the module so the input can go away, the bytes then don't refer to a file offset
+  bool load_all();
+
+  uint32_t id() const;
+  size_t num_sections() const;
+
+  // Lays out the sections from base, returns the first address past them
+  uint32_t place(uint32_t base);
+
+  // Applies the relocations, imports from modules in the layout are patched to their targets
+  bool link_relocations(module_layout const &layout);
+
+  // XTRN slots of the imports that weren't linked go at address, returns the first address past them
+  uint32_t place_imports(uint32_t address);
+
+  bool write_linked(image_sink &sink);
+private:
+  bool apply_steps(image_sink &sink);
+
+  // Prints an error, or holds it back for print_messages. Always false.
+  bool fail(char const *format, ...) const;
+  bool load_image(uint32_t size);
+
+  bool read_header();
+  bool read_sections();
+  bool verify_section(uint32_t offset, uint32_t size) const;
+
+  bool validate_header() const;
+
+  // Addresses of the sections from m_base, nothing is created yet
+  module_placement placement() const;
+  void layout_sections();
+  bool create_sections(image_sink &sink);
+
+  // Relocations are applied to host copies of the sections, then written back in one go
+  void load_section_data();
+  void commit_section_data(image_sink &sink);
+
+  bool apply_relocations(image_sink &sink);
+  bool compile_relocations();
+  bool write_imports(image_sink &sink);
+  bool apply_names(image_sink &sink);
+
+  // Initializes the name and module resolvers
+  void init_resolvers();
+
+  void build_resolve_tables();
+  // Pooled name of a module, made up from the id if no sibling module has it
+  char const *module_name(uint32_t module_id);
+  // nullptr if neither a sibling nor a linked module has the id
+  char const *known_module_name(uint32_t module_id) const;
+
+  // Symbols from <name>.map next to the modules (main.map for the base), empty if there is none
+  symbol_map const &module_symbols(uint32_t module_id);
+  demangle_cache &demangler();
+  uint32_t get_external_offset(uint32_t module_id, uint32_t offset, uint8_t section, bool virt = false) const;
+
+  //
+  uint32_t m_id;
+  uint32_t m_version;
+
+  uint32_t m_num_sections;
+  uint32_t m_section_offset;
+
+  fxn_naming_entry m_prolog_prep;
+  fxn_naming_entry m_epilog_prep;
+  fxn_naming_entry m_unresolved_prep;
+
+  uint32_t m_import_offset;
+  uint32_t m_import_size;
+
+  uint8_t m_bss_section_ign;
+  uint32_t m_bss_size;
+
+  uint32_t m_rel_offset;
+
+  uint32_t m_align;       // version 2
+  uint32_t m_bss_align;   // version 2
+  uint32_t m_fix_size;    // version 3
+  //
+
+  bool m_valid;
+  bool m_hold_messages;
+  mutable std::vector<std::string> m_messages;   // errors held back, also from const checks
+  load_timings m_timings;
+  load_counters *m_counters;
+  rebase_table *m_rebase;
+  demangle_cache *m_shared_demangler;
+  demangle_cache m_demangler;
+  mutable load_diagnostics m_diagnostics;   // also counts from const lookups
+  uint32_t m_max_filesize;
+  input_source * m_input_file;
+  std::vector<uint8_t> m_image;   // file contents read so far, starting at offset 0
+
+  //uint32_t m_next_file_offset;
+  uint32_t m_base;
+  uint32_t m_next_seg_offset;
+  uint8_t m_import_section;
+  uint8_t m_internal_bss_section;
+  module_name_table m_import_modules;
+  module_layout const *m_layout;    // modules linked into the same image, nullptr for a load of its own
+
+  std::vector<import_slot> m_slots;
+  std::vector<import_patch> m_patches;
+  std::vector<uint8_t> m_import_data;
+
+  std::vector<section_entry> m_sections;
+  std::vector< std::vector<uint8_t> > m_section_data;   // empty for BSS and unused sections
+  rel_image m_patch_image;                              // indexes m_section_data
+
+  std::vector<std::string> m_sibling_files;
+  std::string m_index_path;
+
+  string_pool m_names;    // module and generated import names, for as long as the load
+  std::map<uint32_t, char const *> m_module_names;
+  std::vector<std::string> m_map_dirs;
+  std::map<uint32_t, symbol_map> m_symbol_maps;   // loaded on first use
+  std::map<uint8_t, uint32_t> m_segment_address_map;
+
+  std::vector<module_summary> m_external_modules;   // sorted by id
+
+  // Module id -> row, and REL_MAX_SECTIONS entries per row. Row 0 is all RESOLVE_MISSING.
+  std::vector<uint32_t> m_resolve_rows;
+  std::vector<resolved_section> m_resolve_sections;
+};
+
+#endif // #ifndef __REL_TRACK_H__
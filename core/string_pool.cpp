@@ -0,0 +1,197 @@
+#include "string_pool.h"
+#include <cstring>
+
+#define STRING_POOL_MIN_TABLE 256
+
+static size_t hash_string(char const *text, size_t len)
+{
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for ( size_t i = 0; i < len; ++i )
+    hash = (hash ^ static_cast<uint8_t>(text[i])) * 16777619u;
+  return hash;
+}
+
+string_pool::string_pool()
+  : m_top(nullptr)
+  , m_cur(nullptr)
+  , m_limit(nullptr)
+  , m_table(STRING_POOL_MIN_TABLE, static_cast<char const *>(nullptr))
+  , m_count(0)
+  , m_used(0)
+{}
+
+string_pool::~string_pool()
+{
+  this->clear();
+}
+
+void string_pool::clear()
+{
+  for ( size_t i = 0; i < m_blocks.size(); ++i )
+    delete[] m_blocks[i];
+  m_blocks.clear();
+  m_block_sizes.clear();
+  m_top = m_cur = m_limit = nullptr;
+  m_table.assign(STRING_POOL_MIN_TABLE, static_cast<char const *>(nullptr));
+  m_count = 0;
+  m_used = 0;
+}
+
+char const *string_pool::intern(char const *text)
+{
+  return this->intern(text, strlen(text));
+}
+
+char const *string_pool::intern(char const *text, size_t len)
+{
+  this->begin();
+  this->append(text, len);
+  return this->end();
+}
+
+void string_pool::begin()
+{
+  m_cur = m_top;
+}
+
+void string_pool::reserve(size_t count)
+{
+  // The terminator always needs to fit too
+  size_t building = m_cur - m_top;
+  if ( m_cur != nullptr && count < static_cast<size_t>(m_limit - m_cur) )
+    return;
+
+  // Move what was built so far to a new block
+  size_t size = STRING_POOL_BLOCK_SIZE;
+  if ( building + count + 1 > size )
+    size = (building + count + 1) * 2;
+
+  char *block = new char[size];
+  if ( building != 0 )
+    memcpy(block, m_top, building);
+
+  m_blocks.push_back(block);
+  m_block_sizes.push_back(size);
+  m_top = block;
+  m_cur = block + building;
+  m_limit = block + size;
+}
+
+void string_pool::append(char const *text)
+{
+  this->append(text, strlen(text));
+}
+
+void string_pool::append(char const *text, size_t len)
+{
+  this->reserve(len);
+  memcpy(m_cur, text, len);
+  m_cur += len;
+}
+
+void string_pool::append_char(char c)
+{
+  this->reserve(1);
+  *m_cur++ = c;
+}
+
+void string_pool::append_hex(uint32_t value)
+{
+  static char const digits[] = "0123456789abcdef";
+
+  int count = 1;
+  while ( count < 8 && (value >> (count * 4)) != 0 )
+    ++count;
+
+  this->reserve(2 + count);
+  *m_cur++ = '0';
+  *m_cur++ = 'x';
+  for ( int i = count - 1; i >= 0; --i )
+    *m_cur++ = digits[(value >> (i * 4)) & 0xF];
+}
+
+void string_pool::append_dec(uint32_t value)
+{
+  char buf[10];
+  int count = 0;
+  do
+  {
+    buf[count++] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while ( value != 0 );
+
+  this->reserve(count);
+  while ( count > 0 )
+    *m_cur++ = buf[--count];
+}
+
+char const *string_pool::end()
+{
+  this->reserve(0);
+  size_t len = m_cur - m_top;
+  *m_cur = '\0';
+
+  char const *found = this->find_or_insert(m_top, len);
+  if ( found == m_top )
+  {
+    // Keep it, the next string starts after the terminator
+    m_top = m_cur + 1;
+    m_used += len + 1;
+  }
+  m_cur = m_top;
+  return found;
+}
+
+char const *string_pool::find_or_insert(char const *text, size_t len)
+{
+  size_t mask = m_table.size() - 1;
+  for ( size_t i = hash_string(text, len) & mask; ; i = (i + 1) & mask )
+  {
+    char const *entry = m_table[i];
+    if ( entry == nullptr )
+    {
+      m_table[i] = text;
+      if ( ++m_count * 2 > m_table.size() )
+        this->grow_table();
+      return text;
+    }
+    if ( strncmp(entry, text, len) == 0 && entry[len] == '\0' )
+      return entry;
+  }
+}
+
+void string_pool::grow_table()
+{
+  std::vector<char const *> old(m_table.size() * 2, static_cast<char const *>(nullptr));
+  old.swap(m_table);
+
+  size_t mask = m_table.size() - 1;
+  for ( size_t i = 0; i < old.size(); ++i )
+  {
+    if ( old[i] == nullptr )
+      continue;
+    size_t j = hash_string(old[i], strlen(old[i])) & mask;
+    while ( m_table[j] != nullptr )
+      j = (j + 1) & mask;
+    m_table[j] = old[i];
+  }
+}
+
+size_t string_pool::size() const
+{
+  return m_count;
+}
+
+size_t string_pool::bytes_used() const
+{
+  return m_used;
+}
+
+size_t string_pool::bytes_reserved() const
+{
+  size_t total = m_table.size() * sizeof(char const *);
+  for ( size_t i = 0; i < m_block_sizes.size(); ++i )
+    total += m_block_sizes[i];
+  return total;
+}
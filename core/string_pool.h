@@ -0,0 +1,61 @@
+#ifndef __STRING_POOL_H__
+#define __STRING_POOL_H__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Size of each arena block, longer strings get a block of their own
+#define STRING_POOL_BLOCK_SIZE 0x10000
+
+// Deduplicated, NUL terminated strings in arena blocks that are freed together with the pool.
+// Interned strings never move, the pointers stay valid as long as the pool.
+//
+// Strings can also be built in place at the end of the arena:
+//   pool.begin(); pool.append(name); pool.append_hex(offset); char const *s = pool.end();
+class string_pool
+{
+public:
+  string_pool();
+  ~string_pool();
+
+  char const *intern(char const *text);
+  char const *intern(char const *text, size_t len);
+
+  void begin();
+  void append(char const *text);
+  void append(char const *text, size_t len);
+  void append_char(char c);
+  // 0x followed by lowercase digits
+  void append_hex(uint32_t value);
+  void append_dec(uint32_t value);
+  // Interns the string built since begin
+  char const *end();
+
+  size_t size() const;              // distinct strings
+  size_t bytes_used() const;        // string bytes including terminators
+  size_t bytes_reserved() const;    // arena and table memory
+
+  void clear();
+
+private:
+  string_pool(string_pool const &);
+  string_pool &operator =(string_pool const &);
+
+  // Makes room for count more bytes of the string being built
+  void reserve(size_t count);
+  char const *find_or_insert(char const *text, size_t len);
+  void grow_table();
+
+  std::vector<char *> m_blocks;
+  std::vector<size_t> m_block_sizes;
+  char *m_top;          // start of the string being built
+  char *m_cur;          // end of the string being built
+  char *m_limit;        // end of the current block
+
+  std::vector<char const *> m_table;    // open addressing, a power of two in size
+  size_t m_count;
+  size_t m_used;
+};
+
+#endif // #ifndef __STRING_POOL_H__
@@ -0,0 +1,278 @@
+#include "symbol_map.h"
+#include "demangle.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// At most this many columns come before the name
+#define MAP_MAX_TOKENS 8
+
+static bool is_space(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static bool parse_hex(char const *token, size_t len, uint32_t &value)
+{
+  if ( len == 0 || len > 8 )
+    return false;
+
+  value = 0;
+  for ( size_t i = 0; i < len; ++i )
+  {
+    char c = token[i];
+    uint32_t digit;
+    if ( c >= '0' && c <= '9' )
+      digit = c - '0';
+    else if ( c >= 'a' && c <= 'f' )
+      digit = c - 'a' + 10;
+    else if ( c >= 'A' && c <= 'F' )
+      digit = c - 'A' + 10;
+    else
+      return false;
+    value = (value << 4) | digit;
+  }
+  return true;
+}
+
+static bool token_is(char const *token, size_t len, char const *word)
+{
+  return strlen(word) == len && memcmp(token, word, len) == 0;
+}
+
+static bool is_decimal(char const *token, size_t len)
+{
+  for ( size_t i = 0; i < len; ++i )
+  {
+    if ( token[i] < '0' || token[i] > '9' )
+      return false;
+  }
+  return len != 0;
+}
+
+static bool symbol_less(map_symbol const &a, map_symbol const &b)
+{
+  if ( a.m_section != b.m_section )
+    return a.m_section < b.m_section;
+  return a.m_offset < b.m_offset;
+}
+
+enum section_kind
+{
+  KIND_EMPTY = 0,
+  KIND_CODE,
+  KIND_DATA,
+  KIND_BSS
+};
+
+static section_kind map_section_kind(char const *name)
+{
+  if ( strcmp(name, ".init") == 0 || strcmp(name, ".text") == 0 )
+    return KIND_CODE;
+  if ( strcmp(name, ".bss") == 0 || strcmp(name, ".sbss") == 0 || strcmp(name, ".sbss2") == 0 )
+    return KIND_BSS;
+  return KIND_DATA;
+}
+
+static section_kind rel_section_kind(section_entry const &section)
+{
+  if ( section.size == 0 )
+    return KIND_EMPTY;
+  if ( section.file_offset == 0 )
+    return KIND_BSS;
+  return (section.file_offset & SECTION_EXEC) ? KIND_CODE : KIND_DATA;
+}
+
+static bool symbol_unplaced(map_symbol const &symbol)
+{
+  return symbol.m_section == 0xFF;
+}
+
+static bool symbol_same_place(map_symbol const &a, map_symbol const &b)
+{
+  return a.m_section == b.m_section && a.m_offset == b.m_offset;
+}
+
+bool symbol_map::load(char const *path, bool absolute)
+{
+  m_text.clear();
+  m_symbols.clear();
+  m_sections.clear();
+
+  FILE *fp = fopen(path, "rb");
+  if ( fp == nullptr )
+    return false;
+
+  std::vector<char> text;
+  bool ok = fseek(fp, 0, SEEK_END) == 0;
+  long size = ok ? ftell(fp) : -1;
+  if ( size > 0 && fseek(fp, 0, SEEK_SET) == 0 )
+  {
+    text.resize(static_cast<size_t>(size));
+    ok = fread(&text[0], 1, text.size(), fp) == text.size();
+  }
+  fclose(fp);
+
+  return ok && this->parse(text, absolute);
+}
+
+bool symbol_map::parse(std::vector<char> &text, bool absolute)
+{
+  m_symbols.clear();
+  m_sections.clear();
+  m_text.swap(text);
+  m_text.push_back('\0');
+
+  char *p = &m_text[0];
+  char *end = p + m_text.size() - 1;
+  unsigned section = 0;
+  bool in_layout = false;
+
+  while ( p < end )
+  {
+    char *line = p;
+    char *eol = static_cast<char *>(memchr(p, '\n', end - p));
+    if ( eol == nullptr )
+      eol = end;
+    p = eol + 1;
+
+    // Split the line into tokens without copying
+    char *tokens[MAP_MAX_TOKENS];
+    size_t lengths[MAP_MAX_TOKENS];
+    size_t count = 0;
+    for ( char *c = line; c < eol && count < MAP_MAX_TOKENS; )
+    {
+      while ( c < eol && is_space(*c) )
+        ++c;
+      if ( c == eol )
+        break;
+      tokens[count] = c;
+      while ( c < eol && !is_space(*c) )
+        ++c;
+      lengths[count] = c - tokens[count];
+      ++count;
+    }
+    if ( count == 0 )
+      continue;
+
+    // ".text section layout" starts the symbols of the next section
+    if ( count == 3 && token_is(tokens[1], lengths[1], "section") && token_is(tokens[2], lengths[2], "layout") )
+    {
+      ++section;
+      in_layout = true;
+      tokens[0][lengths[0]] = '\0';
+      map_section layout = { static_cast<uint32_t>(tokens[0] - &m_text[0]), 0 };
+      m_sections.push_back(layout);
+      continue;
+    }
+    if ( count == 2 && token_is(tokens[0], lengths[0], "Memory") && token_is(tokens[1], lengths[1], "map:") )
+    {
+      in_layout = false;
+      continue;
+    }
+    if ( !in_layout || section > 0xFF || count < 4 )
+      continue;
+
+    // start size virtual [file offset] [alignment] name object...
+    uint32_t start, size, address, file_offset;
+    if ( !parse_hex(tokens[0], lengths[0], start) || !parse_hex(tokens[1], lengths[1], size) ||
+         !parse_hex(tokens[2], lengths[2], address) )
+      continue;
+
+    if ( !absolute && start + size > m_sections.back().m_size )
+      m_sections.back().m_size = start + size;
+
+    size_t next = 3;
+    if ( lengths[next] == 8 && parse_hex(tokens[next], lengths[next], file_offset) && next + 1 < count )
+      ++next;
+    if ( is_decimal(tokens[next], lengths[next]) && next + 1 < count )
+      ++next;
+
+    // Section and object entries start with a dot, padding with a star
+    char *name = tokens[next];
+    if ( name[0] == '.' || name[0] == '*' )
+      continue;
+    name[lengths[next]] = '\0';
+
+    map_symbol symbol;
+    symbol.m_section = static_cast<uint8_t>(absolute ? SYMBOL_SECTION_ABSOLUTE : section);
+    symbol.m_offset = absolute ? address : start;
+    symbol.m_name = static_cast<uint32_t>(name - &m_text[0]);
+    m_symbols.push_back(symbol);
+  }
+
+  // The first name listed at a place wins
+  std::stable_sort(m_symbols.begin(), m_symbols.end(), symbol_less);
+  m_symbols.erase(std::unique(m_symbols.begin(), m_symbols.end(), symbol_same_place), m_symbols.end());
+  return true;
+}
+
+bool symbol_map::match_sections(section_entry const *sections, size_t count)
+{
+  // Section numbers of the map's sections, 0xFF for those that don't get any
+  std::vector<uint8_t> numbers(m_sections.size() + 1, 0xFF);
+  size_t next = 0;
+  for ( size_t i = 0; i < m_sections.size(); ++i )
+  {
+    map_section const &layout = m_sections[i];
+    if ( layout.m_size == 0 )
+      continue;
+
+    while ( next < count && rel_section_kind(sections[next]) == KIND_EMPTY )
+      ++next;
+    if ( next == count || next > 0xFF ||
+         rel_section_kind(sections[next]) != map_section_kind(&m_text[layout.m_name]) ||
+         layout.m_size > sections[next].size )
+    {
+      m_symbols.clear();
+      return false;
+    }
+    numbers[i + 1] = static_cast<uint8_t>(next++);
+  }
+
+  for ( auto it = m_symbols.begin(); it != m_symbols.end(); ++it )
+    it->m_section = numbers[it->m_section];
+  m_symbols.erase(std::remove_if(m_symbols.begin(), m_symbols.end(), symbol_unplaced), m_symbols.end());
+  std::stable_sort(m_symbols.begin(), m_symbols.end(), symbol_less);
+  return true;
+}
+
+char const *symbol_map::find(uint8_t section, uint32_t offset) const
+{
+  map_symbol key;
+  key.m_section = section;
+  key.m_offset = offset;
+
+  auto it = std::lower_bound(m_symbols.begin(), m_symbols.end(), key, symbol_less);
+  if ( it == m_symbols.end() || !symbol_same_place(*it, key) )
+    return nullptr;
+  return this->name(*it);
+}
+
+size_t symbol_map::size() const
+{
+  return m_symbols.size();
+}
+
+map_symbol const &symbol_map::symbol(size_t index) const
+{
+  return m_symbols[index];
+}
+
+char const *symbol_map::name(map_symbol const &symbol) const
+{
+  return &m_text[symbol.m_name];
+}
+
+void name_map_symbols(symbol_map const &map, image_sink &sink)
+{
+  // Every name of an absolute map is there once, nothing to gain from a cache
+  std::string demangled;
+  for ( size_t i = 0; i < map.size(); ++i )
+  {
+    map_symbol const &symbol = map.symbol(i);
+    sink.set_name(symbol.m_offset, map.name(symbol));
+    if ( cw_demangle(map.name(symbol), demangled) )
+      sink.add_comment(symbol.m_offset, demangled.c_str());
+  }
+}
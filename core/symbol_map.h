@@ -0,0 +1,60 @@
+#ifndef __SYMBOL_MAP_H__
+#define __SYMBOL_MAP_H__
+
+#include "image_sink.h"
+#include "rel.h"
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Section key of symbols in an absolute (DOL) map, which are keyed by address
+#define SYMBOL_SECTION_ABSOLUTE 0
+
+struct map_symbol
+{
+  uint32_t m_offset;    // offset in the section, or the address in an absolute map
+  uint32_t m_name;      // position of the name in the map text
+  uint8_t  m_section;
+};
+
+// A "<name> section layout" block of a map
+struct map_section
+{
+  uint32_t m_name;      // position of the name in the map text
+  uint32_t m_size;      // end of the last entry listed
+};
+
+// Symbols of a CodeWarrior linker map, sorted by (section, offset).
+// The file is read in one go and names are terminated in place, nothing is allocated per symbol.
+class symbol_map
+{
+public:
+  // Absolute maps key symbols by virtual address. Otherwise they are keyed by section, numbered
+  // from 1 in the order the map lists them until match_sections ties them to the REL's sections.
+  bool load(char const *path, bool absolute);
+
+  // Parses map text held in memory, which is modified in place
+  bool parse(std::vector<char> &text, bool absolute);
+
+  // Name of the symbol that starts exactly at the given place, nullptr if there is none
+  char const *find(uint8_t section, uint32_t offset) const;
+
+  // CodeWarrior leaves empty sections out of the map, so its sections are matched to the non-empty
+  // ones of the REL in order, by kind (code, data or .bss) and size, and the symbols renumbered.
+  // False if a section of the map has no counterpart, the symbols are dropped then.
+  bool match_sections(section_entry const *sections, size_t count);
+
+  size_t size() const;
+  map_symbol const &symbol(size_t index) const;
+  char const *name(map_symbol const &symbol) const;
+
+private:
+  std::vector<char> m_text;
+  std::vector<map_symbol> m_symbols;
+  std::vector<map_section> m_sections;
+};
+
+// Names every symbol of an absolute map, with the demangled name as a comment
+void name_map_symbols(symbol_map const &map, image_sink &sink);
+
+#endif // #ifndef __SYMBOL_MAP_H__
@@ -0,0 +1,163 @@
+#include "yaz0.h"
+#include "be_field.h"
+#include <algorithm>
+
+// Longest run a single back-reference can produce
+#define YAZ0_MAX_RUN  (0xFF + 0x12)
+
+yaz0_source::yaz0_source(input_source &input)
+  : m_input(input)
+  , m_compressed(false)
+  , m_failed(false)
+  , m_size(0)
+  , m_decoded(0)
+  , m_group(0)
+  , m_group_bits(0)
+  , m_in_pos(YAZ0_HEADER_SIZE)
+  , m_in_at(0)
+  , m_in_have(0)
+{
+  uint8_t header[YAZ0_HEADER_SIZE];
+  if ( input.size() >= sizeof(header) && input.read(0, header, sizeof(header)) && load_be32(header) == YAZ0_MAGIC )
+  {
+    m_compressed = true;
+    m_size = load_be32(header + 4);
+
+    // No three input bytes decode to more than one longest back-reference, so a header claiming
+    // more than that is corrupt. It reads as empty, which no probe accepts.
+    uint64_t most = (input.size() - YAZ0_HEADER_SIZE + 2) / 3 * YAZ0_MAX_RUN;
+    if ( m_size > YAZ0_MAX_SIZE || m_size > most )
+    {
+      m_size = 0;
+      m_failed = true;
+      return;
+    }
+    m_in_buf.resize(YAZ0_CHUNK_SIZE);
+  }
+}
+
+bool yaz0_source::is_compressed() const
+{
+  return m_compressed;
+}
+
+uint64_t yaz0_source::size() const
+{
+  return m_compressed ? m_size : m_input.size();
+}
+
+bool yaz0_source::read(uint64_t offset, void *dst, size_t count)
+{
+  if ( !m_compressed )
+    return m_input.read(offset, dst, count);
+
+  if ( offset > m_size || count > m_size - offset )
+    return false;
+  if ( !this->decode_to(static_cast<size_t>(offset + count)) )
+    return false;
+  if ( count != 0 )
+    memcpy(dst, &m_output[static_cast<size_t>(offset)], count);
+  return true;
+}
+
+uint64_t yaz0_source::file_offset(uint64_t offset) const
+{
+  // Decompressed bytes have no position in the file
+  return m_compressed ? NO_FILE_OFFSET : m_input.file_offset(offset);
+}
+
+bool yaz0_source::fill()
+{
+  uint64_t left = m_input.size() > m_in_pos ? m_input.size() - m_in_pos : 0;
+  size_t count = static_cast<size_t>(std::min<uint64_t>(left, m_in_buf.size()));
+  if ( count == 0 || !m_input.read(m_in_pos, &m_in_buf[0], count) )
+    return false;
+
+  m_in_pos += count;
+  m_in_at = 0;
+  m_in_have = count;
+  return true;
+}
+
+bool yaz0_source::decode_to(size_t end)
+{
+  if ( end <= m_decoded )
+    return true;
+  if ( m_failed )
+    return false;
+
+  // Decode ahead a little so small sequential reads don't restart the loop each time
+  size_t target = std::max(end, std::max(m_decoded*2, static_cast<size_t>(0x1000)));
+  target = std::min(target, static_cast<size_t>(m_size));
+
+  // Room for a run that starts just before the target
+  size_t capacity = std::min(target + YAZ0_MAX_RUN, static_cast<size_t>(m_size));
+  if ( m_output.size() < capacity )
+    m_output.resize(capacity);
+
+  uint8_t *out = &m_output[0];
+  size_t pos = m_decoded;
+  while ( pos < target )
+  {
+    if ( m_group_bits == 0 )
+    {
+      if ( !this->next_byte(m_group) )
+        break;
+      m_group_bits = 8;
+    }
+
+    if ( m_group & 0x80 )
+    {
+      // Literal byte
+      if ( !this->next_byte(out[pos]) )
+        break;
+      ++pos;
+    }
+    else
+    {
+      // Back-reference: 4 bits length, 12 bits distance, and an extra length byte for long runs
+      uint8_t b1, b2;
+      if ( !this->next_byte(b1) || !this->next_byte(b2) )
+        break;
+
+      size_t distance = (((b1 & 0x0F) << 8) | b2) + 1;
+      size_t count = b1 >> 4;
+      if ( count == 0 )
+      {
+        uint8_t b3;
+        if ( !this->next_byte(b3) )
+          break;
+        count = b3 + 0x12;
+      }
+      else
+      {
+        count += 2;
+      }
+
+      if ( distance > pos || count > m_size - pos )
+        break;
+
+      uint8_t const *src = out + pos - distance;
+      if ( distance >= count )
+      {
+        memcpy(out + pos, src, count);
+      }
+      else
+      {
+        // Overlapping run repeats the last distance bytes
+        for ( size_t i = 0; i < count; ++i )
+          out[pos + i] = src[i];
+      }
+      pos += count;
+    }
+
+    m_group <<= 1;
+    --m_group_bits;
+  }
+
+  // Stopping short means the stream is truncated or corrupt, nothing past this point can be trusted
+  m_decoded = pos;
+  if ( pos < target )
+    m_failed = true;
+  return m_decoded >= end;
+}
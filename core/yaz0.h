@@ -0,0 +1,58 @@
+#ifndef __YAZ0_H__
+#define __YAZ0_H__
+
+#include "input_source.h"
+#include <vector>
+
+#define YAZ0_MAGIC        0x59617A30   // 'Yaz0'
+#define YAZ0_HEADER_SIZE  0x10
+#define YAZ0_CHUNK_SIZE   0x10000
+#define YAZ0_MAX_SIZE     0x10000000   // largest decompressed size accepted, like archive blocks
+
+// Presents the decompressed contents of a Yaz0 file, and any other input unchanged.
+// Decoding is incremental: only as much is decompressed as has been read so far,
+// reading the compressed data in fixed size chunks.
+class yaz0_source : public input_source
+{
+public:
+  yaz0_source(input_source &input);
+
+  bool is_compressed() const;
+
+  uint64_t size() const;
+  bool read(uint64_t offset, void *dst, size_t count);
+  uint64_t file_offset(uint64_t offset) const;
+
+private:
+  yaz0_source(yaz0_source const &);
+  yaz0_source &operator =(yaz0_source const &);
+
+  bool decode_to(size_t end);
+  bool fill();
+
+  bool next_byte(uint8_t &value)
+  {
+    if ( m_in_at == m_in_have && !this->fill() )
+      return false;
+    value = m_in_buf[m_in_at++];
+    return true;
+  }
+
+  input_source &m_input;
+  bool m_compressed;
+  bool m_failed;
+  uint32_t m_size;                // decompressed size from the header
+
+  std::vector<uint8_t> m_output;  // decompressed data, valid up to m_decoded
+  size_t m_decoded;
+
+  uint8_t m_group;                // flags of the current group, consumed from the top
+  unsigned m_group_bits;
+
+  uint64_t m_in_pos;              // next offset to read from m_input
+  size_t m_in_at;
+  size_t m_in_have;
+  std::vector<uint8_t> m_in_buf;   // YAZ0_CHUNK_SIZE once the input turns out to be compressed
+};
+
+#endif // #ifndef __YAZ0_H__
@@ -4,99 +4,133 @@
  *
  */
 
-#include "../loader/idaloader.h"
-#include "dol.h"
+#include "../loader/ida_io.h"
+#include "../core/dol_file.h"
+#include "../core/yaz0.h"
+#include "../core/archive.h"
+#include "../core/symbol_map.h"
+#include "../core/load_stats.h"
+#include "../core/game_link.h"
+#include "../core/module_index.h"
+
+// The second format offered also links the RELs next to the database
+#define DOL_LINKED_SUFFIX " + RELs (linked)"
 
 /*--------------------------------------------------------------------------
  *
- *   Read the header of the (possible) DOL file into memory. Swap all bytes
- *   because the file is stored as big endian.
+ *   Locate the DOL in the input. A disc image boots the DOL that is listed
+ *   as sys/main.dol, anything else is taken to be the DOL itself.
  *
  */
 
-int read_header(linput_t *fp, dolhdr *dhdr)
+static int locate_dol(input_source &input, uint64_t *offset, uint64_t *size)
 {
-  int i;
+  archive_member dol;
 
-  // read in dolheader
-  qlseek(fp, 0, SEEK_SET);
-  if(qlread(fp, dhdr, sizeof(dolhdr)) != sizeof(dolhdr)) return(0);
+  *offset = 0;
+  *size = input.size();
+  if (!is_archive(input) || !find_archive_member(input, GCM_DOL_PATH, dol)) return(0);
 
-  // convert header
-  for (i=0; i<7; i++) {
-    dhdr->offsetText[i] = swap32(dhdr->offsetText[i]);
-    dhdr->addressText[i] = swap32(dhdr->addressText[i]);
-    dhdr->sizeText[i] = swap32(dhdr->sizeText[i]);
-  }
-  for (i=0; i<11; i++) {
-    dhdr->offsetData[i] = swap32(dhdr->offsetData[i]);
-    dhdr->addressData[i] = swap32(dhdr->addressData[i]);
-    dhdr->sizeData[i] = swap32(dhdr->sizeData[i]);
-  }
-  dhdr->entrypoint = swap32(dhdr->entrypoint);
-  dhdr->sizeBSS = swap32(dhdr->sizeBSS);
-  dhdr->addressBSS = swap32(dhdr->addressBSS);
+  *offset = dol.m_offset;
+  *size = dol.m_size;
   return(1);
 }
 
+/*--------------------------------------------------------------------------
+ *
+ *   Name the functions from a CodeWarrior linker map next to the database,
+ *   either named like it or main.map like the DOL on the disc.
+ *
+ */
+
+static void load_dol_names(image_sink &sink)
+{
+  char path[QMAXPATH], dir[QMAXPATH];
+  symbol_map symbols;
+
+  set_file_ext(path, sizeof(path), database_idb, "map");
+  if (!symbols.load(path, true))
+  {
+    if (!qdirname(dir, sizeof(dir), database_idb)) return;
+    qmakepath(path, sizeof(path), dir, "main.map", NULL);
+    if (!symbols.load(path, true)) return;
+  }
+
+  msg("DOL: %u names from %s\n", (unsigned)symbols.size(), path);
+  name_map_symbols(symbols, sink);
+}
+
+/*--------------------------------------------------------------------------
+ *
+ *   Load the modules next to the database into it behind the DOL. Their
+ *   imports from each other and from the DOL are patched to the real
+ *   targets, modules that aren't there still get XTRN slots. A DOL from
+ *   a disc image also gets the modules on that disc.
+ *
+ */
+
+static int idaapi enum_modules_cb(char const *file, void *ud)
+{
+  static_cast<std::vector<std::string> *>(ud)->push_back(file);
+  return 0;
+}
+
+static void link_dol_modules(dolhdr const *dhdr, int disc, image_sink &sink, load_timings &timings)
+{
+  char dir[QMAXPATH], input_path[QMAXPATH], input_dir[QMAXPATH];
+  std::vector<std::string> files;
+  game_link link;
+
+  if (!qdirname(dir, sizeof(dir), database_idb)) return;
+  for (char const * const *ext = module_source_extensions; *ext != NULL; ++ext)
+    enumerate_files(NULL, 0, dir, (std::string("*") + *ext).c_str(), &enum_modules_cb, &files);
+
+  // the disc the DOL came from holds the game's modules, unless it was already found next to the database
+  if (disc && get_input_file_path(input_path, sizeof(input_path)) > 0 &&
+      (!qdirname(input_dir, sizeof(input_dir), input_path) || strcmp(input_dir, dir) != 0))
+    files.push_back(input_path);
+
+  link.set_files(files);
+  link.set_dol(true);
+  link.set_base((dol_end_address(dhdr) + LINK_MODULE_ALIGN - 1) & ~(LINK_MODULE_ALIGN - 1));
+  if (!link.link(sink)) msg("DOL: Some modules failed to link\n");
+  msg("DOL: Linked %u modules up to %08X\n", (unsigned)link.num_modules(), link.end_address());
+  timings.add(link.timings());
+}
+
 /*--------------------------------------------------------------------------
  *
  *   Check if input file can be a DOL file. Therefore the supposed header
  *   is checked for sanity. If it passes return and fill in the formatname
- *   otherwise return 0
+ *   otherwise return 0. Yaz0 compressed files are checked after decoding,
+ *   disc images by the DOL they boot. Every DOL is offered twice, with
+ *   and without the RELs next to it.
  *
  */
 
 int idaapi accept_file(linput_t *fp, char fileformatname[MAX_FILE_FORMAT_NAME], int n)
 {
-  int i;
-
   dolhdr dhdr;
-  ulong filelen, valid = 0;
+  uint64_t offset, size;
+  int disc;
 
-  if(n) return(0);
+  if(n > 1) return(0);
 
-  // first get the lenght of the file
-  
-  filelen = qlsize(fp);
-  // if to short for a DOL header then this is no DOL
-  if (filelen < 0x100) return(0);
+  linput_source file(fp);
+  yaz0_source decoded(file);
+  disc = locate_dol(decoded, &offset, &size);
+  slice_source input(decoded, offset, size);
 
   // read DOL header from file
-  if (read_header(fp, &dhdr)==0) return(0);
+  if (read_dol_header(input, &dhdr)==0) return(0);
   
   // now perform some sanitychecks
-  for (i=0; i<7; i++) {
-    
-    // DOL segment MAY NOT physically stored in the header
-    if (dhdr.offsetText[i]!=0 && dhdr.offsetText[i]<0x100) return(0);
-    // end of physical storage must be within file
-    if (dhdr.offsetText[i]+dhdr.sizeText[i]>filelen) return(0);
-    // we only accept DOLs with segments above 2GB
-    if (dhdr.addressText[i] != 0 && !(dhdr.addressText[i] & 0x80000000)) return(0);
-
-    // remember that entrypoint was in a code segment
-    if (dhdr.entrypoint >= dhdr.addressText[i] && dhdr.entrypoint < dhdr.addressText[i]+dhdr.sizeText[i]) valid = 1;
-  }
-  for (i=0; i<11; i++) {
-
-    // DOL segment MAY NOT physically stored in the header
-    if (dhdr.offsetData[i]!=0 && dhdr.offsetData[i]<0x100) return(0);
-    // end of physical storage must be within file
-    if (dhdr.offsetData[i]+dhdr.sizeData[i]>filelen) return(0);
-    // we only accept DOLs with segments above 2GB
-    if (dhdr.addressData[i] != 0 && !(dhdr.addressData[i] & 0x80000000)) return(0);
-  }
-  
-  // if there is a BSS segment it must be above 2GB, too
-  if (dhdr.addressBSS != 0 && !(dhdr.addressBSS & 0x80000000)) return(0);
-  
-  // if entrypoint is not within a code segment reject this file
-  if (!valid) return(0);
+  if (check_dol_header(&dhdr, input.size())==0) return(0);
 
   // file has passed all sanity checks and might be a DOL
-  qstrncpy(fileformatname, "Nintendo GameCube DOL", MAX_FILE_FORMAT_NAME);
-  return(ACCEPT_FIRST | 0xD07);
+  qsnprintf(fileformatname, MAX_FILE_FORMAT_NAME, "%s%s", disc ? "Nintendo GameCube DOL (disc image)" : "Nintendo GameCube DOL",
+            n ? DOL_LINKED_SUFFIX : "");
+  return(n ? 0xD07 : (ACCEPT_FIRST | 0xD07));
 }
 
 
@@ -108,11 +142,15 @@ int idaapi accept_file(linput_t *fp, char fileformatname[MAX_FILE_FORMAT_NAME],
  *
  */
 
-void idaapi load_file(linput_t *fp, ushort /*neflag*/, const char * /*fileformatname*/)
+void idaapi load_file(linput_t *fp, ushort /*neflag*/, const char *fileformatname)
 {
   dolhdr dhdr;
-  uint snum;
-  int i;
+  uint64_t offset, size;
+  load_timings timings;
+  load_counters counters;
+  char path[QMAXPATH];
+  int stats = load_stats_enabled();
+  int disc;
 
   // Hello here I am
   msg("---------------------------------------\n");
@@ -125,8 +163,18 @@ void idaapi load_file(linput_t *fp, ushort /*neflag*/, const char * /*fileformat
 
   set_compiler_id(COMP_GNU);
 
+  // with WII_LOADER_STATS set reads and database calls are counted
+  linput_source file(fp);
+  counting_source counted_file(file, counters);
+  yaz0_source decoded(stats ? static_cast<input_source &>(counted_file) : file);
+  disc = locate_dol(decoded, &offset, &size);
+  slice_source input(decoded, offset, size);
+
   // read DOL header into memory
-  if (read_header(fp, &dhdr)==0) qexit(1);
+  {
+    load_phase_scope timer(timings, PHASE_READ_HEADER);
+    if (read_dol_header(input, &dhdr)==0) qexit(1);
+  }
   
   // every journey has a beginning
   inf.beginEA = inf.startIP = dhdr.entrypoint;
@@ -134,55 +182,30 @@ void idaapi load_file(linput_t *fp, ushort /*neflag*/, const char * /*fileformat
   // map selector 1 to 0
   set_selector(1, 0);
 
-  // create all code segments
-  for (i=0, snum=1; i<7; i++, snum++) {
-    char buf[50];
-    
-    // 0 == no segment
-    if (dhdr.addressText[i] == 0) continue;
-    
-    // create a name according to segmenttype and number
-    sprintf(buf, NAME_CODE "%u", snum);
-    
-    // add the code segment
-    if (!add_segm(1, dhdr.addressText[i], dhdr.addressText[i]+dhdr.sizeText[i], buf, CLASS_CODE)) qexit(1);
-    
-    // set addressing to 32 bit
-    set_segm_addressing(getseg(dhdr.addressText[i]), 1);
-
-    // and get the content from the file
-    file2base(fp, dhdr.offsetText[i], dhdr.addressText[i], dhdr.addressText[i]+dhdr.sizeText[i], FILEREG_PATCHABLE);
+  // create all segments and get the content from the file
+  ida_sink ida;
+  counting_sink counted_sink(ida, counters);
+  image_sink &sink = stats ? static_cast<image_sink &>(counted_sink) : ida;
+  {
+    load_phase_scope timer(timings, PHASE_CREATE_SECTIONS);
+    if (load_dol(input, &dhdr, sink)==0) qexit(1);
   }
 
-  // create all data segments
-  for (i=0, snum=1; i<11; i++, snum++) {
-    char buf[50];
-
-    // 0 == no segment
-    if (dhdr.addressData[i] == 0) continue;
-
-    // create a name according to segmenttype and number
-    sprintf(buf, NAME_DATA "%u", snum);
-
-    // add the data segment
-    if (!add_segm(1, dhdr.addressData[i], dhdr.addressData[i]+dhdr.sizeData[i], buf, CLASS_DATA)) qexit(1);
-    
-    // set addressing to 32 bit
-    set_segm_addressing(getseg(dhdr.addressData[i]), 1);
-
-    // and get the content from the file
-    file2base(fp, dhdr.offsetData[i], dhdr.addressData[i], dhdr.addressData[i]+dhdr.sizeData[i], FILEREG_PATCHABLE);
+  // give the functions their real names if the linker map is around
+  {
+    load_phase_scope timer(timings, PHASE_APPLY_NAMES);
+    load_dol_names(sink);
   }
 
-  // is there a BSS defined?
-  if (dhdr.addressBSS != NULL) {
-    // then add it
-    if(!add_segm(1, dhdr.addressBSS, dhdr.addressBSS+dhdr.sizeBSS, NAME_BSS, CLASS_BSS)) qexit(1);
+  // and put the game's modules next to it
+  if (strstr(fileformatname, DOL_LINKED_SUFFIX) != NULL) link_dol_modules(&dhdr, disc, sink, timings);
 
-    // and set addressing mode to 32 bit
-    set_segm_addressing(getseg(dhdr.addressBSS), 1);
-  }
- 
+  // report on the load, also as JSON next to the database
+  if (!stats) return;
+  print_load_stats(qbasename(database_idb), timings, counters);
+  set_file_ext(path, sizeof(path), database_idb, "load.json");
+  if (!save_load_stats(path, qbasename(database_idb), timings, counters))
+    msg("DOL: Unable to write %s\n", path);
 }
 
 /*--------------------------------------------------------------------------
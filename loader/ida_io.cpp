@@ -0,0 +1,112 @@
+#include "ida_io.h"
+#include <vector>
+
+#define REBASE_NODE_NAME  "$ wii loader rebase"
+#define REBASE_NODE_TAG   'R'
+
+// Core messages go to the output window
+int rel_vmsg(const char *format, va_list va)
+{
+  return vmsg(format, va);
+}
+
+linput_source::linput_source(linput_t *li)
+  : m_input(li)
+  , m_size(static_cast<uint64_t>(qlsize(li)))
+{}
+
+uint64_t linput_source::size() const
+{
+  return m_size;
+}
+
+bool linput_source::read(uint64_t offset, void *dst, size_t count)
+{
+  if ( offset > m_size || count > m_size - offset )
+    return false;
+  if ( qlseek(m_input, static_cast<int32>(offset), SEEK_SET) != static_cast<int32>(offset) )
+    return false;
+  return qlread(m_input, dst, count) == static_cast<ssize_t>(count);
+}
+
+bool ida_sink::add_segment(uint32_t start, uint32_t end, char const *name, char const *sclass)
+{
+  if ( !add_segm(1, start, end, name, sclass) )
+    return false;
+  set_segm_addressing(getseg(start), 1);
+  return true;
+}
+
+bool ida_sink::load_bytes(uint32_t ea, void const *data, size_t size, uint64_t file_offset)
+{
+  int32 fpos = file_offset == NO_FILE_OFFSET ? -1 : static_cast<int32>(file_offset);
+  return mem2base(data, ea, ea + static_cast<uint32_t>(size), fpos) != 0;
+}
+
+void ida_sink::patch_bytes(uint32_t ea, void const *data, size_t size)
+{
+  patch_many_bytes(ea, data, size);
+}
+
+void ida_sink::put_bytes(uint32_t ea, void const *data, size_t size)
+{
+  put_many_bytes(ea, data, size);
+}
+
+void ida_sink::set_name(uint32_t ea, char const *name)
+{
+  do_name_anyway(ea, name);
+}
+
+void ida_sink::add_comment(uint32_t ea, char const *text)
+{
+  add_long_cmt(ea, true, "%s", text);
+}
+
+void ida_sink::add_program_comment(char const *text)
+{
+  add_pgm_cmt("%s", text);
+}
+
+void ida_sink::add_export(uint32_t ea, char const *name)
+{
+  add_entry(ea, ea, name, true);
+
+  // Make library functions (emphasis)
+  set_libitem(ea);
+}
+
+bool ida_memory::read(uint32_t ea, void *dst, size_t size)
+{
+  return get_many_bytes(ea, dst, static_cast<ssize_t>(size));
+}
+
+void ida_memory::write(uint32_t ea, void const *data, size_t size)
+{
+  patch_many_bytes(ea, data, size);
+}
+
+bool save_rebase_table(rebase_table const &table)
+{
+  std::vector<uint8_t> blob;
+  table.save(blob);
+
+  netnode node(REBASE_NODE_NAME, 0, true);
+  return node.setblob(&blob[0], blob.size(), 0, REBASE_NODE_TAG);
+}
+
+bool load_rebase_table(rebase_table &table)
+{
+  netnode node(REBASE_NODE_NAME);
+  if ( node == BADNODE )
+    return false;
+
+  size_t size = node.blobsize(0, REBASE_NODE_TAG);
+  if ( size == 0 )
+    return false;
+
+  std::vector<uint8_t> blob(size);
+  if ( node.getblob(&blob[0], &size, 0, REBASE_NODE_TAG) == NULL )
+    return false;
+  return table.load(&blob[0], size);
+}
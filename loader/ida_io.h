@@ -0,0 +1,49 @@
+#ifndef __IDA_IO_H__
+#define __IDA_IO_H__
+
+#include "idaloader.h"
+#include "../core/input_source.h"
+#include "../core/image_sink.h"
+#include "../core/rebase_table.h"
+
+// Reads through IDA's loader input
+class linput_source : public input_source
+{
+public:
+  linput_source(linput_t *li);
+
+  uint64_t size() const;
+  bool read(uint64_t offset, void *dst, size_t count);
+
+private:
+  linput_t *m_input;
+  uint64_t m_size;
+};
+
+// Writes into the current database
+class ida_sink : public image_sink
+{
+public:
+  bool add_segment(uint32_t start, uint32_t end, char const *name, char const *sclass);
+  bool load_bytes(uint32_t ea, void const *data, size_t size, uint64_t file_offset);
+  void patch_bytes(uint32_t ea, void const *data, size_t size);
+  void put_bytes(uint32_t ea, void const *data, size_t size);
+  void set_name(uint32_t ea, char const *name);
+  void add_comment(uint32_t ea, char const *text);
+  void add_program_comment(char const *text);
+  void add_export(uint32_t ea, char const *name);
+};
+
+// Re-applies relocations to the bytes in the current database
+class ida_memory : public rebase_memory
+{
+public:
+  bool read(uint32_t ea, void *dst, size_t size);
+  void write(uint32_t ea, void const *data, size_t size);
+};
+
+// The rebase table of a loaded module is kept in the database, for when it is moved
+bool save_rebase_table(rebase_table const &table);
+bool load_rebase_table(rebase_table &table);
+
+#endif // #ifndef __IDA_IO_H__
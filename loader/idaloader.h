@@ -18,16 +18,6 @@
 #include <nalt.hpp>
 #include <typeinf.hpp>
 
-#define CLASS_CODE    "CODE"
-#define NAME_CODE     ".text"
-
-#define CLASS_DATA    "DATA"
-#define NAME_DATA     ".data"
-
-#define CLASS_BSS     "BSS"
-#define NAME_BSS      ".bss"
-
-#define CLASS_EXTERN  "XTRN"
-#define NAME_EXTERN   ".ref"
+#include "../core/image_sink.h"
 
 #endif //#ifndef __IDA_LOADER_H__
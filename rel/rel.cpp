@@ -4,8 +4,12 @@
 *
 */
 
-#include "rel.h"
-#include "rel_track.h"
+#include "../loader/ida_io.h"
+#include "../core/rel_track.h"
+#include "../core/module_scan.h"
+#include "../core/yaz0.h"
+#include "../core/archive.h"
+#include "../core/load_stats.h"
 
 
 
@@ -15,17 +19,73 @@
 *   is checked for sanity. If so return and fill in the formatname
 *   otherwise return 0
 *
+*   IDA offers every file it opens to every loader, so this must be
+*   cheap and quiet. The probe is kept for the load_file that follows.
+*   Yaz0 compressed files are probed after decoding.
+*
+*   For a U8/RARC archive every REL inside it is offered as its own
+*   format, IDA asks for them one by one with increasing n.
+*
 */
 
+#define ARCHIVE_FORMAT_PREFIX "Nintendo REL #"
+
+static module_probe probe_cache;
+static linput_t *probe_cache_input = NULL;
+
+static std::vector<archive_member> archive_cache;   // REL members of the archive last offered
+static linput_t *archive_cache_input = NULL;
+
+static void find_archive_modules(input_source &input, std::vector<archive_member> &modules)
+{
+  std::vector<archive_member> members;
+  modules.clear();
+  if ( !read_archive(input, members) )
+    return;
+
+  for ( size_t i = 0; i < members.size(); ++i )
+  {
+    if ( !is_module_source(members[i].m_path) )
+      continue;
+
+    slice_source slice(input, members[i].m_offset, members[i].m_size);
+    yaz0_source member(slice);
+    module_probe probe;
+    if ( probe_module(member, probe) )
+      modules.push_back(members[i]);
+  }
+}
+
 int idaapi accept_file(linput_t *fp, char fileformatname[MAX_FILE_FORMAT_NAME], int n)
 {
-  if (n) return(0);
+  linput_source file(fp);
+  yaz0_source input(file);
+  if (n == 0)
+  {
+    probe_cache_input = NULL;
+    archive_cache_input = NULL;
+  }
 
-  rel_track test_valid(fp);
+  if (is_archive(input))
+  {
+    if (n == 0)
+    {
+      find_archive_modules(input, archive_cache);
+      archive_cache_input = fp;
+    }
+    if (archive_cache_input != fp || n < 0 || static_cast<size_t>(n) >= archive_cache.size())
+      return 0;
+
+    qsnprintf(fileformatname, MAX_FILE_FORMAT_NAME, ARCHIVE_FORMAT_PREFIX "%d %s", n, archive_cache[n].m_path.c_str());
+    return n == 0 ? (ACCEPT_FIRST | 0xD07) : 0xD07;
+  }
+
+  if (n) return(0);
 
   // Check if valid
-  if (!test_valid.is_good())
+  if (!probe_module(input, probe_cache))
     return 0;
+  probe_cache_input = fp;
 
   // file has passed all sanity checks and might be a rel
   qstrncpy(fileformatname, "Nintendo REL", MAX_FILE_FORMAT_NAME);
@@ -34,6 +94,36 @@ int idaapi accept_file(linput_t *fp, char fileformatname[MAX_FILE_FORMAT_NAME],
 
 
 
+/*-----------------------------------------------------------------
+*
+*   Collect the other modules in the directory of the database,
+*   imports are resolved against them.
+*
+*/
+
+static int idaapi enum_modules_cb(char const * file, void * ud)
+{
+  static_cast<std::vector<std::string> *>(ud)->push_back(file);
+  return 0;
+}
+
+static void find_sibling_modules(rel_track &track)
+{
+  // Retrieve the directory of the current database
+  char dir[260] = {};
+  if ( !qdirname(dir, sizeof(dir), database_idb) )
+    msg("REL: Unable to get directory of idb file.\n");
+  std::string path = dir;
+
+  std::vector<std::string> files;
+  for ( char const * const *ext = module_source_extensions; *ext != nullptr; ++ext )
+    enumerate_files(nullptr, 0, path.c_str(), (std::string("*") + *ext).c_str(), &enum_modules_cb, &files);
+
+  track.set_sibling_modules(files, path + "/" MODULE_INDEX_NAME);
+}
+
+
+
 /*-----------------------------------------------------------------
 *
 *   File was recognised as rel and user has selected it.
@@ -41,8 +131,10 @@ int idaapi accept_file(linput_t *fp, char fileformatname[MAX_FILE_FORMAT_NAME],
 *
 */
 
-void idaapi load_file(linput_t *fp, ushort neflag, const char * /*fileformatname*/)
+void idaapi load_file(linput_t *fp, ushort neflag, const char * fileformatname)
 {
+  ea_t base = START;
+
   // Hello here I am
   msg("---------------------------------------\n");
   msg("Nintendo REL Loader Plugin 0.1\n");
@@ -54,15 +146,103 @@ void idaapi load_file(linput_t *fp, ushort neflag, const char * /*fileformatname
 
   set_compiler_id(COMP_GNU);
 
-  rel_track track(fp);
-  inf.beginEA = START;
+  // With WII_LOADER_STATS set reads and database calls are counted
+  load_counters counters;
+  bool stats = load_stats_enabled();
+  linput_source file(fp);
+  counting_source counted_file(file, counters);
+  yaz0_source decoded(stats ? static_cast<input_source &>(counted_file) : file);
+
+  // A REL inside an archive is read in place
+  uint64_t offset = 0, size = decoded.size();
+  int member = -1;
+  if (strncmp(fileformatname, ARCHIVE_FORMAT_PREFIX, strlen(ARCHIVE_FORMAT_PREFIX)) == 0)
+  {
+    member = atoi(fileformatname + strlen(ARCHIVE_FORMAT_PREFIX));
+    if (archive_cache_input != fp)
+      find_archive_modules(decoded, archive_cache);
+    if (member < 0 || static_cast<size_t>(member) >= archive_cache.size())
+    {
+      msg("REL: Archive member %d not found\n", member);
+      qexit(1);
+    }
+    offset = archive_cache[member].m_offset;
+    size = archive_cache[member].m_size;
+    msg("Loading %s\n", archive_cache[member].m_path.c_str());
+  }
+
+  slice_source slice(decoded, offset, size);
+  yaz0_source input(slice);
+  rel_track track(input, member < 0 && probe_cache_input == fp ? &probe_cache : NULL);
+  probe_cache_input = NULL;
+  archive_cache_input = NULL;
+  if (!track.is_good())
+  {
+    warning("REL: The module could not be read, see the output window");
+    qexit(1);
+  }
+
+  // A manual load can put the module anywhere, e.g. where a memory dump has it
+  if ((neflag & NEF_MAN) != 0 && !askaddr(&base, "Load address of the REL"))
+    base = START;
+  track.set_base(base);
+  inf.beginEA = base;
 
   // map selector 1 to 0
   set_selector(1, 0);
 
+  find_sibling_modules(track);
+
+  ida_sink ida;
+  counting_sink counted_sink(ida, counters);
+  rebase_table rebase;
+  if (stats)
+    track.set_counters(&counters);
+  track.set_rebase_table(&rebase);
+  track.apply_patches(stats ? static_cast<image_sink &>(counted_sink) : ida);
+
+  // Kept so a rebase only has to patch the relocations again
+  if (!save_rebase_table(rebase))
+    msg("REL: Unable to store the relocations for rebasing\n");
+
+  // Report on the load, also as JSON next to the database
+  if (stats)
+  {
+    char path[QMAXPATH];
+    char const *name = member < 0 ? qbasename(database_idb) : archive_cache[member].m_path.c_str();
+    print_load_stats(name, track.timings(), counters);
+    set_file_ext(path, sizeof(path), database_idb, "load.json");
+    if (!save_load_stats(path, name, track.timings(), counters))
+      msg("REL: Unable to write %s\n", path);
+  }
+}
+
+/*-----------------------------------------------------------------
+*
+*   A segment or the whole program was moved. The relocations stored
+*   at load time are patched again for their new addresses, the file
+*   isn't read again. from is BADADDR when the whole program moved by
+*   to.
+*
+*/
+
+int idaapi rebase_segm(ea_t from, ea_t to, asize_t size, const char * /*fileformatname*/)
+{
+  rebase_table table;
+  if (!load_rebase_table(table))
+    return 1;
 
+  // The whole program is every address
+  if (from == BADADDR)
+  {
+    from = 0;
+    size = BADADDR;
+  }
 
-  track.apply_patches();
+  ida_memory memory;
+  size_t patched = table.move(from, to, size, memory);
+  msg("REL: %u relocations patched for the move\n", static_cast<unsigned>(patched));
+  return save_rebase_table(table) ? 1 : 0;
 }
 
 /*-----------------------------------------------------------------
@@ -77,4 +257,5 @@ extern "C" loader_t LDSC = {
   accept_file,
   load_file,
   NULL,
+  rebase_segm,
 };
@@ -0,0 +1,560 @@
+/*
+*  Command line front end for the REL/DOL loader core
+*
+*  Loads a DOL and/or REL modules without IDA, applies the relocations
+*  and writes a flat memory image plus a report of segments and names.
+*
+*/
+
+#include "../core/rel_track.h"
+#include "../core/game_link.h"
+#include "../core/dol_file.h"
+#include "../core/yaz0.h"
+#include "../core/archive.h"
+#include "../core/symbol_map.h"
+#include "../core/load_stats.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <dirent.h>
+
+int rel_vmsg(const char *format, va_list va)
+{
+  return vfprintf(stderr, format, va);
+}
+
+struct flat_segment
+{
+  uint32_t m_start;
+  uint32_t m_end;
+  std::string m_name;
+  std::string m_class;
+  std::vector<uint8_t> m_data;
+};
+
+// Collects everything in memory, then writes it out as one flat image
+class flat_sink : public image_sink, public rebase_memory
+{
+public:
+  bool add_segment(uint32_t start, uint32_t end, char const *name, char const *sclass)
+  {
+    if ( end < start )
+      return false;
+    for ( auto it = m_segments.begin(); it != m_segments.end(); ++it )
+    {
+      if ( start < it->m_end && it->m_start < end )
+        return false;
+    }
+
+    flat_segment seg;
+    seg.m_start = start;
+    seg.m_end = end;
+    seg.m_name = name;
+    seg.m_class = sclass;
+    seg.m_data.resize(end - start);
+    m_segments.push_back(seg);
+    return true;
+  }
+
+  bool load_bytes(uint32_t ea, void const *data, size_t size, uint64_t /*file_offset*/)
+  {
+    return this->store(ea, data, size);
+  }
+
+  void patch_bytes(uint32_t ea, void const *data, size_t size)
+  {
+    this->store(ea, data, size);
+  }
+
+  void put_bytes(uint32_t ea, void const *data, size_t size)
+  {
+    this->store(ea, data, size);
+  }
+
+  void set_name(uint32_t ea, char const *name)
+  {
+    m_names[ea] = name;
+  }
+
+  void add_comment(uint32_t ea, char const *text)
+  {
+    m_comments.insert(std::make_pair(ea, std::string(text)));
+  }
+
+  void add_program_comment(char const *text)
+  {
+    m_program.push_back(text);
+  }
+
+  void add_export(uint32_t ea, char const *name)
+  {
+    m_names[ea] = name;
+    m_exports.push_back(ea);
+  }
+
+  bool read(uint32_t ea, void *dst, size_t size)
+  {
+    for ( auto it = m_segments.begin(); it != m_segments.end(); ++it )
+    {
+      if ( ea >= it->m_start && ea <= it->m_end && size <= it->m_end - ea )
+      {
+        memcpy(dst, &it->m_data[ea - it->m_start], size);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void write(uint32_t ea, void const *data, size_t size)
+  {
+    this->store(ea, data, size);
+  }
+
+  // Moves the segments in [from, from + size) and everything named in them to to, like rebasing a database
+  void move(uint32_t from, uint32_t to, uint32_t size)
+  {
+    uint32_t delta = to - from;
+    for ( auto it = m_segments.begin(); it != m_segments.end(); ++it )
+    {
+      if ( it->m_start - from < size )
+      {
+        it->m_start += delta;
+        it->m_end += delta;
+      }
+    }
+
+    std::map<uint32_t, std::string> names;
+    for ( auto it = m_names.begin(); it != m_names.end(); ++it )
+      names[it->first - from < size ? it->first + delta : it->first] = it->second;
+    m_names.swap(names);
+
+    std::multimap<uint32_t, std::string> comments;
+    for ( auto it = m_comments.begin(); it != m_comments.end(); ++it )
+      comments.insert(std::make_pair(it->first - from < size ? it->first + delta : it->first, it->second));
+    m_comments.swap(comments);
+
+    for ( auto it = m_exports.begin(); it != m_exports.end(); ++it )
+      *it += *it - from < size ? delta : 0;
+  }
+
+  bool write_image(char const *path) const
+  {
+    if ( m_segments.empty() )
+      return false;
+
+    uint32_t lo = 0xFFFFFFFF, hi = 0;
+    for ( auto it = m_segments.begin(); it != m_segments.end(); ++it )
+    {
+      lo = std::min(lo, it->m_start);
+      hi = std::max(hi, it->m_end);
+    }
+
+    std::vector<uint8_t> image(hi - lo);
+    for ( auto it = m_segments.begin(); it != m_segments.end(); ++it )
+    {
+      if ( !it->m_data.empty() )
+        memcpy(&image[it->m_start - lo], &it->m_data[0], it->m_data.size());
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if ( fp == nullptr )
+      return false;
+    bool ok = image.empty() || fwrite(&image[0], 1, image.size(), fp) == image.size();
+    fclose(fp);
+
+    fprintf(stderr, "Wrote %u bytes based at %08X to %s\n", static_cast<unsigned>(image.size()), lo, path);
+    return ok;
+  }
+
+  bool write_report(char const *path) const
+  {
+    FILE *fp = fopen(path, "w");
+    if ( fp == nullptr )
+      return false;
+
+    for ( auto it = m_program.begin(); it != m_program.end(); ++it )
+      fprintf(fp, "; %s\n", it->c_str());
+
+    fprintf(fp, "\n; Segments\n");
+    for ( auto it = m_segments.begin(); it != m_segments.end(); ++it )
+      fprintf(fp, "%08X-%08X %-4s %s\n", it->m_start, it->m_end, it->m_class.c_str(), it->m_name.c_str());
+
+    fprintf(fp, "\n; Exports\n");
+    for ( auto it = m_exports.begin(); it != m_exports.end(); ++it )
+      fprintf(fp, "%08X %s\n", *it, m_names.find(*it)->second.c_str());
+
+    fprintf(fp, "\n; Names\n");
+    for ( auto it = m_names.begin(); it != m_names.end(); ++it )
+    {
+      auto range = m_comments.equal_range(it->first);
+      for ( auto c = range.first; c != range.second; ++c )
+        fprintf(fp, "         ; %s\n", c->second.c_str());
+      fprintf(fp, "%08X %s\n", it->first, it->second.c_str());
+    }
+    fclose(fp);
+    return true;
+  }
+
+private:
+  bool store(uint32_t ea, void const *data, size_t size)
+  {
+    for ( auto it = m_segments.begin(); it != m_segments.end(); ++it )
+    {
+      if ( ea >= it->m_start && ea <= it->m_end && size <= it->m_end - ea )
+      {
+        memcpy(&it->m_data[ea - it->m_start], data, size);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::vector<flat_segment> m_segments;
+  std::map<uint32_t, std::string> m_names;
+  std::multimap<uint32_t, std::string> m_comments;
+  std::vector<std::string> m_program;
+  std::vector<uint32_t> m_exports;
+};
+
+static void list_modules(char const *dir, std::vector<std::string> &files)
+{
+  DIR *d = opendir(dir);
+  if ( d == nullptr )
+  {
+    fprintf(stderr, "Unable to open module directory %s\n", dir);
+    return;
+  }
+
+  while ( dirent *e = readdir(d) )
+  {
+    if ( is_module_source(e->d_name) )
+      files.push_back(std::string(dir) + "/" + e->d_name);
+  }
+  closedir(d);
+}
+
+// Splits "archive:member" into its parts, the member is empty for a plain file
+static void split_member(std::string const &arg, std::string &path, std::string &member_path)
+{
+  size_t colon = arg.find(':');
+  path = arg.substr(0, colon);
+  member_path = colon == std::string::npos ? std::string() : arg.substr(colon + 1);
+}
+
+// Range of the named member, or of the whole input if no member is named.
+// An archive given without a member stands for default_member when it has one.
+static bool locate_member(input_source &input, std::string const &member_path, char const *default_member,
+                          uint64_t &offset, uint64_t &size)
+{
+  offset = 0;
+  size = input.size();
+
+  archive_member member;
+  if ( member_path.empty() )
+  {
+    if ( default_member != nullptr && is_archive(input) && find_archive_member(input, default_member, member) )
+    {
+      offset = member.m_offset;
+      size = member.m_size;
+    }
+    return true;
+  }
+
+  if ( !find_archive_member(input, member_path, member) )
+    return false;
+  offset = member.m_offset;
+  size = member.m_size;
+  return true;
+}
+
+static void usage()
+{
+  fprintf(stderr,
+    "usage: relink [options] [module.rel | archive:member.rel ...]\n"
+    "  -b base     load address of the first module (default %08X, or the end of the DOL with -l)\n"
+    "  -d file     DOL to load first, or a disc image to load its main.dol\n"
+    "  -l dir      directory of modules to link with the DOL into one image\n"
+    "  -n file     linker map to name the DOL's functions from\n"
+    "  -m dir      directory of modules to resolve imports against\n"
+    "  -o file     flat memory image to write (default image.bin)\n"
+    "  -r file     segment and name report to write (default image.txt)\n"
+    "  -s file     load statistics to write as JSON, also printed if " LOAD_STATS_ENV " is set\n"
+    "  -t file     per module phase timings to write, tab separated\n"
+    "  -x base     move the modules to base afterwards through their rebase tables\n",
+    START);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t base = START;
+  bool base_set = false;
+  uint32_t dol_end = 0;
+  char const *dol_path = nullptr;
+  char const *dol_map_path = nullptr;
+  char const *image_path = "image.bin";
+  char const *report_path = "image.txt";
+  char const *timing_path = nullptr;
+  char const *stats_path = nullptr;
+  uint32_t rebase = 0;
+  bool rebase_set = false;
+  bool link_set = false;
+  std::string disc_path;
+  std::vector<std::string> siblings;
+  std::vector<std::string> link_files;
+  std::vector<std::string> modules;
+
+  for ( int i = 1; i < argc; ++i )
+  {
+    std::string arg = argv[i];
+    if ( arg.size() == 2 && arg[0] == '-' && i + 1 < argc )
+    {
+      char const *value = argv[++i];
+      switch ( arg[1] )
+      {
+      case 'b': base = static_cast<uint32_t>(strtoul(value, nullptr, 16)); base_set = true; break;
+      case 'd': dol_path = value; break;
+      case 'l': list_modules(value, link_files); link_set = true; break;
+      case 'm': list_modules(value, siblings); break;
+      case 'n': dol_map_path = value; break;
+      case 'o': image_path = value; break;
+      case 'r': report_path = value; break;
+      case 's': stats_path = value; break;
+      case 't': timing_path = value; break;
+      case 'x': rebase = static_cast<uint32_t>(strtoul(value, nullptr, 16)); rebase_set = true; break;
+      default:
+        usage();
+        return 1;
+      }
+    }
+    else if ( arg[0] == '-' )
+    {
+      usage();
+      return 1;
+    }
+    else
+    {
+      modules.push_back(arg);
+    }
+  }
+
+  if ( dol_path == nullptr && modules.empty() && link_files.empty() )
+  {
+    usage();
+    return 1;
+  }
+
+  flat_sink flat;
+  bool print_stats = load_stats_enabled();
+  bool stats = print_stats || stats_path != nullptr;
+
+  // Each load is reported as one element of a JSON array
+  FILE *stats_fp = nullptr;
+  int stats_count = 0;
+  if ( stats_path != nullptr )
+  {
+    stats_fp = fopen(stats_path, "w");
+    if ( stats_fp == nullptr )
+    {
+      fprintf(stderr, "Failed to write %s\n", stats_path);
+      return 1;
+    }
+    fprintf(stats_fp, "[");
+  }
+
+  FILE *timing_fp = nullptr;
+  if ( timing_path != nullptr )
+  {
+    timing_fp = fopen(timing_path, "w");
+    if ( timing_fp == nullptr )
+    {
+      fprintf(stderr, "Failed to write %s\n", timing_path);
+      return 1;
+    }
+    fprintf(timing_fp, "module\tphase\tusec\n");
+  }
+
+  if ( dol_path != nullptr )
+  {
+    std::string path, member_path;
+    split_member(dol_path, path, member_path);
+
+    load_timings timings;
+    load_counters counters;
+    file_source file(path.c_str());
+    counting_source counted(file, counters);
+    yaz0_source decoded(counted);
+    counting_sink sink(flat, counters);
+    uint64_t offset, size;
+    if ( !locate_member(decoded, member_path, GCM_DOL_PATH, offset, size) )
+    {
+      fprintf(stderr, "%s is not in %s\n", member_path.c_str(), path.c_str());
+      return 1;
+    }
+
+    slice_source input(decoded, offset, size);
+    if ( member_path.empty() && is_archive(decoded) )
+      disc_path = path;
+    dolhdr dhdr;
+    {
+      load_phase_scope timer(timings, PHASE_READ_HEADER);
+      if ( !file.is_open() || !read_dol_header(input, &dhdr) || !check_dol_header(&dhdr, input.size()) )
+      {
+        fprintf(stderr, "%s is not a valid DOL\n", dol_path);
+        return 1;
+      }
+    }
+    {
+      load_phase_scope timer(timings, PHASE_CREATE_SECTIONS);
+      if ( !load_dol(input, &dhdr, sink) )
+      {
+        fprintf(stderr, "Failed to load %s\n", dol_path);
+        return 1;
+      }
+      dol_end = dol_end_address(&dhdr);
+    }
+
+    if ( dol_map_path != nullptr )
+    {
+      load_phase_scope timer(timings, PHASE_APPLY_NAMES);
+      symbol_map symbols;
+      if ( !symbols.load(dol_map_path, true) )
+      {
+        fprintf(stderr, "Failed to read %s\n", dol_map_path);
+        return 1;
+      }
+      name_map_symbols(symbols, sink);
+    }
+
+    if ( print_stats )
+      print_load_stats(dol_path, timings, counters);
+    if ( stats_fp != nullptr )
+    {
+      fprintf(stats_fp, "%s\n", stats_count++ ? "," : "");
+      write_load_stats(stats_fp, dol_path, timings, counters, 2);
+    }
+  }
+
+  // A DOL from a disc image is linked with the modules on that disc
+  if ( link_set && !disc_path.empty() && std::find(link_files.begin(), link_files.end(), disc_path) == link_files.end() )
+    link_files.push_back(disc_path);
+
+  // Linked modules start behind the DOL unless told otherwise
+  if ( !link_files.empty() )
+  {
+    load_counters counters;
+    counting_sink sink(flat, counters);
+    game_link link;
+    link.set_files(link_files);
+    link.set_dol(dol_path != nullptr);
+    link.set_base(base_set || dol_end == 0 ? base : (dol_end + LINK_MODULE_ALIGN - 1) & ~(LINK_MODULE_ALIGN - 1));
+    if ( !link.link(sink) )
+      fprintf(stderr, "Some modules failed to link\n");
+    fprintf(stderr, "Linked %u modules up to %08X\n", static_cast<unsigned>(link.num_modules()), link.end_address());
+
+    if ( print_stats )
+      print_load_stats("linked modules", link.timings(), counters);
+    if ( stats_fp != nullptr )
+    {
+      fprintf(stats_fp, "%s\n", stats_count++ ? "," : "");
+      write_load_stats(stats_fp, "linked modules", link.timings(), counters, 2);
+    }
+    base = link.end_address();
+  }
+
+  // Modules are placed one after another, starting at the base
+  uint32_t first_base = base;
+  uint32_t next_base = base;
+  std::vector<rebase_table> rebase_tables(modules.size());
+  for ( auto it = modules.begin(); it != modules.end(); ++it )
+  {
+    // archive:member names a REL inside an archive or disc image
+    std::string path, member_path;
+    split_member(*it, path, member_path);
+
+    load_counters counters;
+    file_source file(path.c_str());
+    counting_source counted(file, counters);
+    yaz0_source decoded(counted);
+    counting_sink sink(flat, counters);
+    uint64_t offset, size;
+    if ( !locate_member(decoded, member_path, nullptr, offset, size) )
+    {
+      fprintf(stderr, "%s is not in %s\n", member_path.c_str(), path.c_str());
+      return 1;
+    }
+
+    slice_source slice(decoded, offset, size);
+    yaz0_source input(slice);
+    rel_track track(input);
+    if ( !file.is_open() || !track.is_good() )
+    {
+      fprintf(stderr, "%s is not a valid REL\n", it->c_str());
+      return 1;
+    }
+
+    track.set_base(next_base);
+    if ( stats )
+      track.set_counters(&counters);
+    if ( rebase_set )
+      track.set_rebase_table(&rebase_tables[it - modules.begin()]);
+    track.set_sibling_modules(siblings, std::string());
+    if ( !track.apply_patches(sink) )
+    {
+      fprintf(stderr, "Failed to load %s\n", it->c_str());
+      return 1;
+    }
+    next_base = (track.end_address() + 0x1F) & ~0x1F;
+
+    if ( print_stats )
+      print_load_stats(it->c_str(), track.timings(), counters);
+    if ( stats_fp != nullptr )
+    {
+      fprintf(stats_fp, "%s\n", stats_count++ ? "," : "");
+      write_load_stats(stats_fp, it->c_str(), track.timings(), counters, 2);
+    }
+
+    if ( timing_fp != nullptr )
+    {
+      load_timings const &timings = track.timings();
+      for ( int phase = 0; phase < PHASE_COUNT; ++phase )
+      {
+        fprintf(timing_fp, "%s\t%s\t%llu\n", it->c_str(), load_phase_name(static_cast<load_phase>(phase)),
+          static_cast<unsigned long long>(timings.m_usec[phase]));
+      }
+    }
+  }
+
+  // Everything the modules created moves together, the same as rebasing a database
+  if ( rebase_set && !modules.empty() )
+  {
+    size_t patched = 0;
+    flat.move(first_base, rebase, next_base - first_base);
+    for ( auto it = rebase_tables.begin(); it != rebase_tables.end(); ++it )
+      patched += it->move(first_base, rebase, next_base - first_base, flat);
+    fprintf(stderr, "Moved modules from %08X to %08X, %u relocations patched\n", first_base, rebase, static_cast<unsigned>(patched));
+  }
+
+  if ( timing_fp != nullptr )
+    fclose(timing_fp);
+  if ( stats_fp != nullptr )
+  {
+    fprintf(stats_fp, "\n]\n");
+    fclose(stats_fp);
+  }
+
+  if ( !flat.write_image(image_path) )
+  {
+    fprintf(stderr, "Failed to write %s\n", image_path);
+    return 1;
+  }
+  if ( !flat.write_report(report_path) )
+  {
+    fprintf(stderr, "Failed to write %s\n", report_path);
+    return 1;
+  }
+  return 0;
+}
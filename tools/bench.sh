@@ -0,0 +1,122 @@
+#!/bin/sh
+#
+#  Loader benchmark driver
+#
+#  Generates module sets with relgen and times relink on them. Prints CSV,
+#  one line per measurement, with the fastest of REPEATS runs:
+#
+#    suite,version,modules,imports,relocations,symbols,threads,phase,usec
+#
+#  phase is one of relink's -t phases, or "wall" for the whole relink run.
+#
+#  usage: bench.sh [suite ...]    (default: phases imports scan names)
+#
+#    phases   relocations of one module from 1000 to 1M, for REL versions 1 to 3
+#    imports  100000 relocations spread over 1 to 256 imported modules, to a few places each
+#    scan     import resolution against 128 to 1024 sibling modules, by thread count
+#    names    linker maps with 64 to 4096 symbols per section
+#
+#  Environment: RELINK, RELGEN (tool paths), WORK (scratch directory),
+#  REPEATS (runs per measurement, default 5), THREADS (default "1 2 4 8"),
+#  MAX_RELOCATIONS (largest module of the phases sweep, default 1000000).
+#
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+RELINK=${RELINK:-$HERE/../relink/relink}
+RELGEN=${RELGEN:-$HERE/relgen}
+WORK=${WORK:-${TMPDIR:-/tmp}/wii-loader-bench}
+REPEATS=${REPEATS:-5}
+THREADS=${THREADS:-"1 2 4 8"}
+MAX_RELOCATIONS=${MAX_RELOCATIONS:-1000000}
+
+for tool in "$RELINK" "$RELGEN"; do
+  if [ ! -x "$tool" ]; then
+    echo "$tool is missing, run make in relink and tools first" >&2
+    exit 1
+  fi
+done
+mkdir -p "$WORK"
+
+now_usec() {
+  echo $(( $(date +%s%N) / 1000 ))
+}
+
+# gen dir relgen-options...
+gen() {
+  dir=$1
+  shift
+  rm -rf "$dir"
+  "$RELGEN" "$@" "$dir" 2>/dev/null
+}
+
+# run suite version modules imports relocations symbols threads dir relink-arguments...
+# Runs relink in dir REPEATS times and prints the fastest time of each phase of mod1.rel and of the run.
+run() {
+  suite=$1 version=$2 modules=$3 imports=$4 relocations=$5 symbols=$6 threads=$7 dir=$8
+  shift 8
+  : > "$WORK/times.tsv"
+  i=0
+  while [ $i -lt "$REPEATS" ]; do
+    start=$(now_usec)
+    (cd "$dir" && WII_LOADER_THREADS=$threads "$RELINK" -o "$WORK/image.bin" -r "$WORK/image.txt" \
+      -t "$WORK/phases.tsv" "$@" >/dev/null 2>&1)
+    end=$(now_usec)
+    awk -F '\t' '$1 == "mod1.rel" { print $2 "\t" $3 }' "$WORK/phases.tsv" >> "$WORK/times.tsv"
+    printf 'wall\t%s\n' $((end - start)) >> "$WORK/times.tsv"
+    rm -f "$WORK/phases.tsv"
+    i=$((i + 1))
+  done
+  awk -F '\t' -v prefix="$suite,$version,$modules,$imports,$relocations,$symbols,$threads" '
+    !($1 in best) { order[n++] = $1; best[$1] = $2 }
+    $2 < best[$1] { best[$1] = $2 }
+    END { for ( i = 0; i < n; ++i ) print prefix "," order[i] "," best[order[i]] }
+  ' "$WORK/times.tsv"
+}
+
+suite_phases() {
+  for version in 1 2 3; do
+    for relocations in 1000 10000 100000 $MAX_RELOCATIONS; do
+      gen "$WORK/phases" -v $version -n 8 -r $relocations -d
+      run phases $version 9 8 $relocations 0 1 "$WORK/phases" -m . -d main.dol mod1.rel
+    done
+  done
+}
+
+suite_imports() {
+  for imports in 1 4 16 64 256; do
+    gen "$WORK/imports" -v 3 -n 256 -i $imports -r 100000 -R 16 -T 4 -d
+    run imports 3 257 $imports 100000 0 1 "$WORK/imports" -m . -d main.dol mod1.rel
+  done
+}
+
+# The sibling scan runs in init_resolvers, linking all modules also reads them in parallel
+suite_scan() {
+  for modules in 128 512 1024; do
+    gen "$WORK/scan" -v 3 -n $((modules - 1)) -i 64 -r 10000 -R 64 -d
+    for threads in $THREADS; do
+      run scan 3 $modules 64 10000 0 $threads "$WORK/scan" -m . -d main.dol mod1.rel
+      run scan-link 3 $modules 64 10000 0 $threads "$WORK/scan" -d main.dol -l .
+    done
+  done
+}
+
+suite_names() {
+  for symbols in 64 256 1024 4096; do
+    gen "$WORK/names" -v 3 -n 8 -r 100000 -m $symbols -d
+    run names 3 9 8 100000 $symbols 1 "$WORK/names" -m . -d main.dol -n main.map mod1.rel
+  done
+}
+
+if [ $# -eq 0 ]; then
+  set -- phases imports scan names
+fi
+
+echo "suite,version,modules,imports,relocations,symbols,threads,phase,usec"
+for suite in "$@"; do
+  case $suite in
+    phases|imports|scan|names) suite_$suite ;;
+    *) echo "Unknown suite $suite" >&2; exit 1 ;;
+  esac
+done
@@ -0,0 +1,84 @@
+#!/bin/sh
+#
+#  Import address check
+#
+#  Loads a generated module of each REL version against its siblings and checks
+#  that every import's virtual address is where the target section lands when
+#  that module is loaded on its own at the default base. Versions 2 and 3 are
+#  laid out differently from version 1, so this catches a resolver that mixes
+#  the two up. Exits non-zero on a mismatch.
+#
+#  Environment: RELINK, RELGEN (tool paths), WORK (scratch directory).
+#
+
+set -e
+
+HERE=$(cd "$(dirname "$0")" && pwd)
+RELINK=${RELINK:-$HERE/../relink/relink}
+RELGEN=${RELGEN:-$HERE/relgen}
+WORK=${WORK:-${TMPDIR:-/tmp}/wii-loader-check}
+
+for tool in "$RELINK" "$RELGEN"; do
+  if [ ! -x "$tool" ]; then
+    echo "$tool is missing, run make in relink and tools first" >&2
+    exit 1
+  fi
+done
+mkdir -p "$WORK"
+
+failed=0
+for version in 1 2 3; do
+  dir=$WORK/v$version
+  rm -rf "$dir"
+  "$RELGEN" -v $version -n 4 -r 2000 -s 3 -d -S $version "$dir" 2>/dev/null
+
+  # Where each module's sections are on their own, then the imports of mod1 seen from its siblings
+  for module in "$dir"/mod*.rel; do
+    name=$(basename "$module" .rel)
+    "$RELINK" -o "$dir/$name.bin" -r "$dir/$name.txt" "$module" >/dev/null 2>&1
+  done
+  (cd "$dir" && "$RELINK" -m . -d main.dol -o image.bin -r image.txt mod1.rel >/dev/null 2>&1)
+
+  for report in "$dir"/mod*.txt; do
+    name=$(basename "$report" .txt)
+    awk -v name="$name" '
+      /^; Segments/ { seg = 1; next }
+      /^$/ { seg = 0 }
+      seg && match($0, /^[0-9A-F]+-[0-9A-F]+ [A-Z]+ +\.[a-z]+[0-9]+$/) {
+        section = $NF
+        sub(/^\.[a-z]+/, "", section)
+        print name, section, substr($1, 1, 8)
+      }
+    ' "$report"
+  done > "$dir/sections.txt"
+
+  if ! awk -v version=$version '
+    function hex(s,    i, v) {
+      v = 0
+      for ( i = 1; i <= length(s); ++i )
+        v = v * 16 + index("0123456789ABCDEF", substr(s, i, 1)) - 1
+      return v
+    }
+    FNR == NR { start[$1 " " $2] = hex($3); next }
+    /^Imports from / { module = $3; next }
+    module != "" && /; addend: [0-9A-F]+; section: [0-9]+; virtual: 0x[0-9A-F]+;/ {
+      addend = $3; section = $5; virtual = $7
+      sub(/;/, "", addend); sub(/;/, "", section); sub(/^0x/, "", virtual); sub(/;/, "", virtual)
+      key = module " " section
+      ++checked
+      if ( !(key in start) || start[key] + hex(addend) != hex(virtual) )
+      {
+        ++wrong
+        if ( wrong <= 5 )
+          printf("  %s section %s addend %s: virtual %s, expected %08X\n", module, section, addend, virtual, start[key] + hex(addend))
+      }
+    }
+    END {
+      printf("version %d: %d imports checked, %d wrong\n", version, checked, wrong)
+      exit checked == 0 || wrong > 0
+    }
+  ' "$dir/sections.txt" "$dir/image.txt"; then
+    failed=1
+  fi
+done
+exit $failed
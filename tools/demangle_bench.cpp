@@ -0,0 +1,115 @@
+/*
+*  Demangler throughput benchmark
+*
+*  Looks up every symbol of the given linker maps a number of times, the way
+*  imports of the same symbols from many modules do, once through cw_demangle
+*  alone and once through a demangle_cache. Prints one CSV line per pass.
+*
+*/
+
+#include "../core/rel.h"
+#include "../core/demangle.h"
+#include "../core/symbol_map.h"
+#include "../core/load_timer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+int rel_vmsg(const char *format, va_list va)
+{
+  return vfprintf(stderr, format, va);
+}
+
+static void usage()
+{
+  fprintf(stderr,
+    "usage: demangle_bench [-k repeats] [-p passes] file.map ...\n"
+    "  -k repeats  how often each name is looked up, like a symbol imported by that many modules (default 16)\n"
+    "  -p passes   timed passes, the fastest is printed (default 5)\n");
+}
+
+int main(int argc, char **argv)
+{
+  unsigned repeats = 16;
+  unsigned passes = 5;
+  std::vector<symbol_map> maps;
+  std::vector<char const *> names;
+
+  for ( int i = 1; i < argc; ++i )
+  {
+    std::string arg = argv[i];
+    if ( (arg == "-k" || arg == "-p") && i + 1 < argc )
+    {
+      unsigned value = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+      if ( arg == "-k" )
+        repeats = value;
+      else
+        passes = value;
+    }
+    else if ( arg[0] == '-' )
+    {
+      usage();
+      return 1;
+    }
+    else
+    {
+      maps.push_back(symbol_map());
+      if ( !maps.back().load(argv[i], false) )
+      {
+        fprintf(stderr, "Failed to read %s\n", argv[i]);
+        return 1;
+      }
+    }
+  }
+  if ( maps.empty() || repeats == 0 || passes == 0 )
+  {
+    usage();
+    return 1;
+  }
+
+  for ( auto it = maps.begin(); it != maps.end(); ++it )
+  {
+    for ( size_t i = 0; i < it->size(); ++i )
+      names.push_back(it->name(it->symbol(i)));
+  }
+
+  // Lookups go round the whole list, so every name is asked for again only after all others
+  uint64_t best_cold = ~0ull;
+  uint64_t best_cached = ~0ull;
+  size_t demangled = 0;
+  size_t cached = 0;
+  for ( unsigned pass = 0; pass < passes; ++pass )
+  {
+    std::string out;
+    demangled = 0;
+    uint64_t start = load_timer_usec();
+    for ( unsigned r = 0; r < repeats; ++r )
+    {
+      for ( auto it = names.begin(); it != names.end(); ++it )
+        demangled += cw_demangle(*it, out) ? 1 : 0;
+    }
+    uint64_t cold = load_timer_usec() - start;
+
+    demangle_cache cache;
+    start = load_timer_usec();
+    for ( unsigned r = 0; r < repeats; ++r )
+    {
+      for ( auto it = names.begin(); it != names.end(); ++it )
+        cache.demangle(*it);
+    }
+    uint64_t warm = load_timer_usec() - start;
+    cached = cache.size();
+
+    best_cold = cold < best_cold ? cold : best_cold;
+    best_cached = warm < best_cached ? warm : best_cached;
+  }
+
+  uint64_t lookups = static_cast<uint64_t>(names.size()) * repeats;
+  printf("names,repeats,lookups,demangled,cache_entries,uncached_usec,cached_usec,uncached_ns_per_lookup,cached_ns_per_lookup\n");
+  printf("%u,%u,%llu,%u,%u,%llu,%llu,%.1f,%.1f\n", static_cast<unsigned>(names.size()), repeats,
+    static_cast<unsigned long long>(lookups), static_cast<unsigned>(demangled / repeats), static_cast<unsigned>(cached),
+    static_cast<unsigned long long>(best_cold), static_cast<unsigned long long>(best_cached),
+    lookups != 0 ? best_cold * 1000.0 / lookups : 0.0, lookups != 0 ? best_cached * 1000.0 / lookups : 0.0);
+  return 0;
+}
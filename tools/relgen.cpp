@@ -0,0 +1,704 @@
+/*
+*  Synthetic REL/DOL generator
+*
+*  Writes a directory of valid modules (and optionally a DOL and linker maps)
+*  with a given number of sections, imports and relocations, for benchmarking
+*  and checking the loader without game files.
+*
+*/
+
+#include "../core/rel.h"
+#include "../core/dol.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <sys/stat.h>
+
+int rel_vmsg(const char *format, va_list va)
+{
+  return vfprintf(stderr, format, va);
+}
+
+#define DOL_TEXT_ADDRESS  0x80003100
+#define DOL_TEXT_SIZE     0x20000
+#define DOL_DATA_SIZE     0x8000
+#define DOL_BSS_SIZE      0x4000
+#define MODULE_SECTION_SIZE 0x1000    // contents of the modules that are only imported from
+
+// Small deterministic generator, so a seed always gives the same files
+class rng
+{
+public:
+  rng(uint32_t seed)
+    : m_state(seed * 2654435761u + 1)
+  {}
+
+  uint32_t next()
+  {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 17;
+    m_state ^= m_state << 5;
+    return m_state;
+  }
+
+  uint32_t below(uint32_t limit)
+  {
+    return limit != 0 ? this->next() % limit : 0;
+  }
+
+private:
+  uint32_t m_state;
+};
+
+struct gen_options
+{
+  gen_options()
+    : m_version(3)
+    , m_modules(4)
+    , m_imports(-1)
+    , m_relocations(1000)
+    , m_other_relocations(64)
+    , m_sections(2)
+    , m_symbols(0)
+    , m_targets(256)
+    , m_dol(false)
+    , m_seed(1)
+  {}
+
+  uint32_t m_version;
+  uint32_t m_modules;           // modules besides the first one
+  int m_imports;                // how many of them the first module imports from, -1 for all
+  uint32_t m_relocations;       // in the first module
+  uint32_t m_other_relocations; // in each other module
+  uint32_t m_sections;          // with contents, code first, then data
+  uint32_t m_symbols;           // per section in the linker maps, 0 for no maps
+  uint32_t m_targets;           // places per section relocations point to without maps
+  bool m_dol;
+  uint32_t m_seed;
+  std::vector<uint32_t> m_mix;  // weight by relocation type
+};
+
+struct gen_section
+{
+  bool m_exec;
+  bool m_bss;
+  uint32_t m_size;
+  uint32_t m_offset;            // in the file, 0 for the BSS
+};
+
+// What a module looks like to the modules that import from it
+struct gen_module
+{
+  uint32_t m_id;
+  std::string m_name;
+  std::vector<gen_section> m_sections;  // by section number, 0 is the null section
+};
+
+struct gen_relocation
+{
+  uint32_t m_module;            // target module id, 0 for the DOL
+  uint8_t m_section;            // where the relocation is
+  uint32_t m_offset;
+  uint8_t m_type;
+  uint8_t m_target_section;
+  uint32_t m_addend;
+};
+
+static bool relocation_less(gen_relocation const &a, gen_relocation const &b)
+{
+  if ( a.m_section != b.m_section )
+    return a.m_section < b.m_section;
+  return a.m_offset < b.m_offset;
+}
+
+struct type_name
+{
+  char const *m_name;
+  uint8_t m_type;
+};
+
+static type_name const type_names[] =
+{
+  { "addr32", R_PPC_ADDR32 },     { "addr24", R_PPC_ADDR24 },   { "addr16", R_PPC_ADDR16 },
+  { "lo", R_PPC_ADDR16_LO },      { "hi", R_PPC_ADDR16_HI },    { "ha", R_PPC_ADDR16_HA },
+  { "addr14", R_PPC_ADDR14 },     { "brtaken", R_PPC_ADDR14_BRTAKEN },
+  { "brntaken", R_PPC_ADDR14_BRNTAKEN },
+  { "rel24", R_PPC_REL24 },       { "rel14", R_PPC_REL14 },
+  { nullptr, 0 }
+};
+
+// Roughly what CodeWarrior output has: calls, lis/addi pairs and pointers in data
+#define DEFAULT_MIX "rel24=40,ha=20,lo=20,addr32=15,rel14=3,addr16=1,hi=1"
+
+static bool parse_mix(char const *text, std::vector<uint32_t> &mix)
+{
+  mix.assign(256, 0);
+  std::string spec(text);
+  size_t pos = 0;
+  while ( pos < spec.size() )
+  {
+    size_t end = spec.find(',', pos);
+    if ( end == std::string::npos )
+      end = spec.size();
+    std::string item = spec.substr(pos, end - pos);
+    pos = end + 1;
+
+    size_t eq = item.find('=');
+    std::string name = item.substr(0, eq);
+    uint32_t weight = eq == std::string::npos ? 1 : static_cast<uint32_t>(strtoul(item.c_str() + eq + 1, nullptr, 10));
+    type_name const *t = type_names;
+    while ( t->m_name != nullptr && name != t->m_name )
+      ++t;
+    if ( t->m_name == nullptr )
+      return false;
+    mix[t->m_type] = weight;
+  }
+  return true;
+}
+
+static uint8_t pick_type(std::vector<uint32_t> const &mix, rng &random)
+{
+  uint32_t total = 0;
+  for ( size_t i = 0; i < mix.size(); ++i )
+    total += mix[i];
+  uint32_t pick = random.below(total);
+  for ( size_t i = 0; i < mix.size(); ++i )
+  {
+    if ( pick < mix[i] )
+      return static_cast<uint8_t>(i);
+    pick -= mix[i];
+  }
+  return R_PPC_ADDR32;
+}
+
+// 16 bit fields are the low half of the instruction
+static uint32_t field_offset(uint8_t type)
+{
+  switch ( type )
+  {
+  case R_PPC_ADDR16:
+  case R_PPC_ADDR16_LO:
+  case R_PPC_ADDR16_HI:
+  case R_PPC_ADDR16_HA:
+    return 2;
+  default:
+    return 0;
+  }
+}
+
+// An instruction the relocation makes sense on
+static uint32_t instruction_for(uint8_t type)
+{
+  switch ( type )
+  {
+  case R_PPC_REL24:
+  case R_PPC_ADDR24:
+    return 0x48000001;    // bl
+  case R_PPC_REL14:
+  case R_PPC_ADDR14:
+  case R_PPC_ADDR14_BRTAKEN:
+  case R_PPC_ADDR14_BRNTAKEN:
+    return 0x41820000;    // beq
+  case R_PPC_ADDR16_HA:
+  case R_PPC_ADDR16_HI:
+    return 0x3C600000;    // lis r3
+  case R_PPC_ADDR16_LO:
+  case R_PPC_ADDR16:
+    return 0x38630000;    // addi r3, r3
+  default:
+    return 0;
+  }
+}
+
+static void put32(std::vector<uint8_t> &out, uint32_t offset, uint32_t value)
+{
+  store_be32(&out[offset], value);
+}
+
+static void append_entry(std::vector<uint8_t> &out, uint16_t offset, uint8_t type, uint8_t section, uint32_t addend)
+{
+  size_t at = out.size();
+  out.resize(at + sizeof(rel_entry));
+  store_be16(&out[at], offset);
+  out[at + 2] = type;
+  out[at + 3] = section;
+  store_be32(&out[at + 4], addend);
+}
+
+// Spacing of the places in a section that relocations point to, which are also the map's symbols
+static uint32_t target_stride(gen_section const &section, uint32_t symbols)
+{
+  uint32_t stride = (section.m_size / std::max(1u, symbols)) & ~3u;
+  return stride != 0 ? stride : 4;
+}
+
+static uint32_t target_count(gen_section const &section, uint32_t symbols)
+{
+  uint32_t count = section.m_size / target_stride(section, symbols);
+  return count != 0 ? count : 1;
+}
+
+// Sections with contents, code first, then one BSS
+static void plan_sections(gen_module &module, uint32_t sections, uint32_t const *sizes)
+{
+  gen_section null_section = { false, false, 0, 0 };
+  module.m_sections.assign(1, null_section);
+  uint32_t code = std::max(1u, sections / 2);
+  for ( uint32_t i = 0; i < sections; ++i )
+  {
+    gen_section section = { i < code, false, sizes[i], 0 };
+    module.m_sections.push_back(section);
+  }
+  gen_section bss = { false, true, 0x400, 0 };
+  module.m_sections.push_back(bss);
+}
+
+// CodeWarrior style name of symbol index in a section, mangled most of the time
+static std::string symbol_name(uint32_t module, uint32_t section, uint32_t index)
+{
+  static char const * const spaces[] = { "game", "sys", "gfx", "snd", "ui", "net", "obj", "stage" };
+  static char const * const classes[] = { "Player", "Enemy", "Camera", "Actor", "Manager", "Buffer", "Texture", "Effect" };
+  static char const * const methods[] = { "update", "draw", "init", "reset", "calc", "get", "set", "execute" };
+  static char const * const params[] = { "v", "i", "f", "Pv", "PCc", "Ri", "ii", "fff", "Ul", "b", "PQ23gfx7Texture", "RCQ24game6Player" };
+
+  uint32_t h = (module * 131 + section) * 7919 + index;
+  char buf[256];
+  if ( h % 5 == 4 )
+  {
+    snprintf(buf, sizeof(buf), "fn_%u_%u_%u", module, section, index);
+    return buf;
+  }
+
+  char const *space = spaces[h % 8];
+  char cls[32];
+  snprintf(cls, sizeof(cls), "%s%u", classes[(h / 8) % 8], module);
+  char const *param = params[(h / 64) % 12];
+  if ( h % 7 == 0 )
+  {
+    snprintf(cls, sizeof(cls), "%s%u_%u", classes[(h / 8) % 8], module, index);
+    snprintf(buf, sizeof(buf), "__ct__Q2%u%s%u%sF%s", static_cast<unsigned>(strlen(space)), space,
+      static_cast<unsigned>(strlen(cls)), cls, param);
+  }
+  else
+    snprintf(buf, sizeof(buf), "%s%u__Q2%u%s%u%s%sF%s", methods[(h / 16) % 8], index,
+      static_cast<unsigned>(strlen(space)), space, static_cast<unsigned>(strlen(cls)), cls,
+      h % 3 == 0 ? "C" : "", param);
+  return buf;
+}
+
+static bool write_file(std::string const &path, std::vector<uint8_t> const &data)
+{
+  FILE *fp = fopen(path.c_str(), "wb");
+  if ( fp == nullptr )
+    return false;
+  bool ok = data.empty() || fwrite(&data[0], 1, data.size(), fp) == data.size();
+  return fclose(fp) == 0 && ok;
+}
+
+// A relocatable module map: symbols are keyed by section offset
+static bool write_module_map(std::string const &path, gen_module const &module, uint32_t symbols)
+{
+  FILE *fp = fopen(path.c_str(), "w");
+  if ( fp == nullptr )
+    return false;
+
+  fprintf(fp, "Link map of _prolog\n\n");
+  for ( size_t s = 1; s < module.m_sections.size(); ++s )
+  {
+    gen_section const &section = module.m_sections[s];
+    fprintf(fp, "%s section layout\n", section.m_bss ? ".bss" : section.m_exec ? ".text" : ".data");
+    fprintf(fp, "  Starting        Virtual\n  address  Size   address\n  -----------------------\n");
+    uint32_t stride = target_stride(section, symbols);
+    uint32_t count = target_count(section, symbols);
+    fprintf(fp, "  %08X %06X %08X  4 %s \t%s.o\n", 0u, section.m_size, 0u,
+      section.m_bss ? ".bss" : section.m_exec ? ".text" : ".data", module.m_name.c_str());
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+      fprintf(fp, "  %08X %06X %08X  4 %s \t%s.o\n", i * stride, stride, 0u,
+        symbol_name(module.m_id, static_cast<uint32_t>(s), i).c_str(), module.m_name.c_str());
+    }
+    fprintf(fp, "\n");
+  }
+  return fclose(fp) == 0;
+}
+
+// The DOL's map is absolute: symbols are keyed by virtual address
+static bool write_dol_map(std::string const &path, gen_module const &dol, uint32_t symbols)
+{
+  FILE *fp = fopen(path.c_str(), "w");
+  if ( fp == nullptr )
+    return false;
+
+  fprintf(fp, "Link map of __start\n\n");
+  uint32_t address = DOL_TEXT_ADDRESS;
+  for ( size_t s = 1; s < dol.m_sections.size(); ++s )
+  {
+    gen_section const &section = dol.m_sections[s];
+    fprintf(fp, "%s section layout\n", section.m_exec ? ".text" : ".data");
+    fprintf(fp, "  Starting        Virtual  File\n  address  Size   address  offset\n  ---------------------------------\n");
+    uint32_t stride = target_stride(section, symbols);
+    uint32_t count = target_count(section, symbols);
+    for ( uint32_t i = 0; i < count; ++i )
+    {
+      fprintf(fp, "  %08X %06X %08X %08X  4 %s \tmain.o\n", i * stride, stride, address + i * stride,
+        section.m_offset + i * stride, symbol_name(0, static_cast<uint32_t>(s), i).c_str());
+    }
+    fprintf(fp, "\n");
+    address += section.m_size;
+  }
+  return fclose(fp) == 0;
+}
+
+// One text and one data section right behind each other, then the BSS
+static std::vector<uint8_t> build_dol(gen_module &dol)
+{
+  gen_section null_section = { false, false, 0, 0 };
+  gen_section text = { true, false, DOL_TEXT_SIZE, 0x100 };
+  gen_section data = { false, false, DOL_DATA_SIZE, 0x100 + DOL_TEXT_SIZE };
+  dol.m_id = 0;
+  dol.m_name = "main";
+  dol.m_sections.clear();
+  dol.m_sections.push_back(null_section);
+  dol.m_sections.push_back(text);
+  dol.m_sections.push_back(data);
+
+  std::vector<uint8_t> out(0x100 + DOL_TEXT_SIZE + DOL_DATA_SIZE, 0);
+  for ( uint32_t i = 0; i < DOL_TEXT_SIZE; i += 4 )
+    put32(out, 0x100 + i, 0x60000000);    // nop
+  put32(out, offsetof(dolhdr, offsetText), text.m_offset);
+  put32(out, offsetof(dolhdr, addressText), DOL_TEXT_ADDRESS);
+  put32(out, offsetof(dolhdr, sizeText), DOL_TEXT_SIZE);
+  put32(out, offsetof(dolhdr, offsetData), data.m_offset);
+  put32(out, offsetof(dolhdr, addressData), DOL_TEXT_ADDRESS + DOL_TEXT_SIZE);
+  put32(out, offsetof(dolhdr, sizeData), DOL_DATA_SIZE);
+  put32(out, offsetof(dolhdr, addressBSS), DOL_TEXT_ADDRESS + DOL_TEXT_SIZE + DOL_DATA_SIZE);
+  put32(out, offsetof(dolhdr, sizeBSS), DOL_BSS_SIZE);
+  put32(out, offsetof(dolhdr, entrypoint), DOL_TEXT_ADDRESS);
+  return out;
+}
+
+// Points a relocation at one of the places of a module that relocations go to
+static void pick_target(gen_module const &target, uint32_t symbols, rng &random, gen_relocation &rel)
+{
+  uint8_t section = static_cast<uint8_t>(1 + random.below(static_cast<uint32_t>(target.m_sections.size() - 1)));
+  gen_section const &s = target.m_sections[section];
+  uint32_t addend = random.below(target_count(s, symbols)) * target_stride(s, symbols);
+
+  if ( target.m_id == 0 )
+  {
+    // Imports from the DOL are absolute addresses
+    uint32_t address = DOL_TEXT_ADDRESS;
+    for ( uint8_t i = 1; i < section; ++i )
+      address += target.m_sections[i].m_size;
+    rel.m_target_section = 0;
+    rel.m_addend = address + addend;
+  }
+  else
+  {
+    rel.m_target_section = section;
+    rel.m_addend = addend;
+  }
+}
+
+// Lays out one module with its relocations, sorted by place on the way
+static std::vector<uint8_t> build_rel(gen_module const &module, uint32_t version, std::vector<gen_relocation> &relocations)
+{
+  uint32_t align = version >= 2 ? 32 : 4;
+  std::vector<uint8_t> out(rel_header_size(version), 0);
+
+  uint32_t section_table = static_cast<uint32_t>(out.size());
+  out.resize(out.size() + module.m_sections.size() * sizeof(section_entry_be), 0);
+
+  // Section contents, each aligned like the linker does
+  std::vector<uint32_t> offsets(module.m_sections.size(), 0);
+  for ( size_t s = 1; s < module.m_sections.size(); ++s )
+  {
+    gen_section const &section = module.m_sections[s];
+    if ( section.m_bss )
+      continue;
+    out.resize((out.size() + align - 1) / align * align, 0);
+    offsets[s] = static_cast<uint32_t>(out.size());
+    out.resize(out.size() + section.m_size, 0);
+    if ( section.m_exec )
+    {
+      for ( uint32_t i = 0; i < section.m_size; i += 4 )
+        put32(out, offsets[s] + i, 0x60000000);    // nop
+    }
+  }
+  for ( size_t s = 0; s < module.m_sections.size(); ++s )
+  {
+    gen_section const &section = module.m_sections[s];
+    uint32_t entry = section_table + static_cast<uint32_t>(s * sizeof(section_entry_be));
+    put32(out, entry, section.m_bss ? 0 : offsets[s] | (section.m_exec ? SECTION_EXEC : 0));
+    put32(out, entry + 4, section.m_size);
+  }
+
+  // Instructions the relocations apply to
+  for ( auto it = relocations.begin(); it != relocations.end(); ++it )
+  {
+    if ( module.m_sections[it->m_section].m_exec )
+      put32(out, offsets[it->m_section] + (it->m_offset & ~3u), instruction_for(it->m_type));
+  }
+
+  // Other modules first, then the module itself and the DOL, like makerel. OSLinkFixed
+  // only keeps what is in front of the last two, which is where fix_size points.
+  std::vector<uint32_t> ids;
+  for ( auto it = relocations.begin(); it != relocations.end(); ++it )
+    ids.push_back(it->m_module);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  std::stable_partition(ids.begin(), ids.end(), [&](uint32_t id) { return id != module.m_id && id != 0; });
+  auto self_or_dol = std::find_if(ids.begin(), ids.end(), [&](uint32_t id) { return id == module.m_id || id == 0; });
+  std::sort(self_or_dol, ids.end(), [&](uint32_t a, uint32_t b) { return a == module.m_id && b != module.m_id; });
+
+  out.resize((out.size() + 3) & ~3u, 0);
+  uint32_t import_offset = static_cast<uint32_t>(out.size());
+  out.resize(out.size() + ids.size() * sizeof(import_entry), 0);
+
+  uint32_t rel_offset = static_cast<uint32_t>(out.size());
+  uint32_t fix_size = rel_offset;
+  std::stable_sort(relocations.begin(), relocations.end(), relocation_less);
+  for ( size_t i = 0; i < ids.size(); ++i )
+  {
+    if ( (ids[i] == module.m_id || ids[i] == 0) && fix_size == rel_offset )
+      fix_size = static_cast<uint32_t>(out.size());
+    put32(out, import_offset + static_cast<uint32_t>(i * sizeof(import_entry)), ids[i]);
+    put32(out, import_offset + static_cast<uint32_t>(i * sizeof(import_entry)) + 4, static_cast<uint32_t>(out.size()));
+
+    int section = -1;
+    uint32_t offset = 0;
+    for ( auto it = relocations.begin(); it != relocations.end(); ++it )
+    {
+      if ( it->m_module != ids[i] )
+        continue;
+      if ( it->m_section != section )
+      {
+        section = it->m_section;
+        offset = 0;
+        append_entry(out, 0, R_DOLPHIN_SECTION, it->m_section, 0);
+      }
+      uint32_t delta = it->m_offset - offset;
+      while ( delta > 0xFFFF )
+      {
+        append_entry(out, 0xFFFF, R_DOLPHIN_NOP, 0, 0);
+        delta -= 0xFFFF;
+      }
+      append_entry(out, static_cast<uint16_t>(delta), it->m_type, it->m_target_section, it->m_addend);
+      offset = it->m_offset;
+    }
+    append_entry(out, 0, R_DOLPHIN_END, 0, 0);
+  }
+  if ( fix_size == rel_offset )
+    fix_size = static_cast<uint32_t>(out.size());
+
+  uint8_t bss_section = 0;
+  for ( size_t s = 0; s < module.m_sections.size(); ++s )
+  {
+    if ( module.m_sections[s].m_bss )
+      bss_section = static_cast<uint8_t>(s);
+  }
+
+  put32(out, offsetof(relhdr, info.id), module.m_id);
+  put32(out, offsetof(relhdr, info.num_sections), static_cast<uint32_t>(module.m_sections.size()));
+  put32(out, offsetof(relhdr, info.section_offset), section_table);
+  put32(out, offsetof(relhdr, info.version), version);
+  put32(out, offsetof(relhdr, bss_size), module.m_sections[bss_section].m_size);
+  put32(out, offsetof(relhdr, rel_offset), rel_offset);
+  put32(out, offsetof(relhdr, import_offset), import_offset);
+  put32(out, offsetof(relhdr, import_size), static_cast<uint32_t>(ids.size() * sizeof(import_entry)));
+  out[offsetof(relhdr, prolog_section)] = 1;
+  out[offsetof(relhdr, epilog_section)] = 1;
+  out[offsetof(relhdr, unresolved_section)] = 1;
+  put32(out, offsetof(relhdr, prolog_offset), 0);
+  put32(out, offsetof(relhdr, epilog_offset), 4);
+  put32(out, offsetof(relhdr, unresolved_offset), 8);
+  if ( version >= 2 )
+  {
+    put32(out, offsetof(relhdr, align), align);
+    put32(out, offsetof(relhdr, bss_align), align);
+  }
+  if ( version >= 3 )
+    put32(out, offsetof(relhdr, fix_size), fix_size);
+  return out;
+}
+
+// Spreads count relocations over the module's sections with contents, targets picked from targets
+static void plan_relocations(gen_module const &module, std::vector<gen_module const *> const &targets,
+                             uint32_t count, gen_options const &opts, rng &random, std::vector<gen_relocation> &out)
+{
+  out.clear();
+  std::vector<uint8_t> sections;
+  for ( size_t s = 1; s < module.m_sections.size(); ++s )
+  {
+    if ( !module.m_sections[s].m_bss )
+      sections.push_back(static_cast<uint8_t>(s));
+  }
+
+  // One relocation per instruction at most, spread evenly
+  for ( uint32_t i = 0; i < count; ++i )
+  {
+    uint8_t section = sections[i % sections.size()];
+    uint32_t slots = module.m_sections[section].m_size / 4;
+    uint32_t per_section = (count + static_cast<uint32_t>(sections.size()) - 1) / static_cast<uint32_t>(sections.size());
+    uint32_t slot = static_cast<uint32_t>((static_cast<uint64_t>(i / sections.size()) * slots) / per_section);
+
+    gen_relocation rel;
+    rel.m_module = targets[random.below(static_cast<uint32_t>(targets.size()))]->m_id;
+    rel.m_section = section;
+    rel.m_type = pick_type(opts.m_mix, random);
+    rel.m_offset = slot * 4 + field_offset(rel.m_type);
+
+    gen_module const *target = nullptr;
+    for ( auto it = targets.begin(); it != targets.end() && target == nullptr; ++it )
+    {
+      if ( (*it)->m_id == rel.m_module )
+        target = *it;
+    }
+    pick_target(*target, opts.m_symbols != 0 ? opts.m_symbols : opts.m_targets, random, rel);
+    out.push_back(rel);
+  }
+}
+
+static void usage()
+{
+  fprintf(stderr,
+    "usage: relgen [options] dir\n"
+    "  -v version  REL version, 1 to 3 (default 3)\n"
+    "  -n count    modules besides mod1.rel (default 4)\n"
+    "  -i count    how many of them mod1.rel imports from (default all)\n"
+    "  -r count    relocations in mod1.rel (default 1000)\n"
+    "  -R count    relocations in each other module (default 64)\n"
+    "  -s count    sections with contents per module, code first (default 2)\n"
+    "  -t mix      relocation type weights (default " DEFAULT_MIX ")\n"
+    "  -m count    write linker maps naming this many symbols per section, mostly mangled\n"
+    "  -T count    places per section relocations point to without -m (default 256)\n"
+    "  -d          also write main.dol, which the modules import from as module 0\n"
+    "  -S seed     random seed (default 1)\n");
+}
+
+int main(int argc, char **argv)
+{
+  gen_options opts;
+  char const *dir = nullptr;
+  parse_mix(DEFAULT_MIX, opts.m_mix);
+
+  for ( int i = 1; i < argc; ++i )
+  {
+    std::string arg = argv[i];
+    if ( arg == "-d" )
+    {
+      opts.m_dol = true;
+    }
+    else if ( arg.size() == 2 && arg[0] == '-' && i + 1 < argc )
+    {
+      char const *value = argv[++i];
+      uint32_t number = static_cast<uint32_t>(strtoul(value, nullptr, 0));
+      switch ( arg[1] )
+      {
+      case 'v': opts.m_version = number; break;
+      case 'n': opts.m_modules = number; break;
+      case 'i': opts.m_imports = static_cast<int>(number); break;
+      case 'r': opts.m_relocations = number; break;
+      case 'R': opts.m_other_relocations = number; break;
+      case 's': opts.m_sections = number; break;
+      case 'm': opts.m_symbols = number; break;
+      case 'T': opts.m_targets = number; break;
+      case 'S': opts.m_seed = number; break;
+      case 't':
+        if ( !parse_mix(value, opts.m_mix) )
+        {
+          fprintf(stderr, "Unknown relocation type in %s\n", value);
+          return 1;
+        }
+        break;
+      default:
+        usage();
+        return 1;
+      }
+    }
+    else if ( arg[0] != '-' && dir == nullptr )
+    {
+      dir = argv[i];
+    }
+    else
+    {
+      usage();
+      return 1;
+    }
+  }
+
+  if ( dir == nullptr || opts.m_version < 1 || opts.m_version > 3 || opts.m_sections < 1 ||
+       opts.m_sections + 2 > REL_MAX_SECTIONS )
+  {
+    usage();
+    return 1;
+  }
+  mkdir(dir, 0777);
+  std::string base(dir);
+  base += "/";
+
+  // Module 1 is the big one, the others are mostly there to be imported from
+  rng random(opts.m_seed);
+  uint32_t total = opts.m_modules + 1;
+  std::vector<gen_module> modules(total);
+  for ( uint32_t m = 0; m < total; ++m )
+  {
+    modules[m].m_id = m + 1;
+    modules[m].m_name = "mod" + std::to_string(static_cast<unsigned long long>(m + 1));
+
+    uint32_t relocs = m == 0 ? opts.m_relocations : opts.m_other_relocations;
+    uint32_t per_section = (relocs + opts.m_sections - 1) / opts.m_sections;
+    std::vector<uint32_t> sizes(opts.m_sections, MODULE_SECTION_SIZE);
+    for ( uint32_t s = 0; s < opts.m_sections; ++s )
+      sizes[s] = std::max<uint32_t>(MODULE_SECTION_SIZE, (per_section * 4 + 0xFF) & ~0xFFu);
+    plan_sections(modules[m], opts.m_sections, &sizes[0]);
+  }
+
+  gen_module dol;
+  if ( opts.m_dol )
+  {
+    std::vector<uint8_t> image = build_dol(dol);
+    if ( !write_file(base + "main.dol", image) || (opts.m_symbols != 0 && !write_dol_map(base + "main.map", dol, opts.m_symbols)) )
+    {
+      fprintf(stderr, "Failed to write main.dol\n");
+      return 1;
+    }
+  }
+
+  uint32_t imports = opts.m_imports < 0 ? opts.m_modules : std::min<uint32_t>(opts.m_imports, opts.m_modules);
+  std::vector<gen_relocation> relocations;
+  uint64_t written = 0;
+  for ( uint32_t m = 0; m < total; ++m )
+  {
+    // Everyone imports from itself and the DOL, the first module also from the first few others,
+    // the others from the first module
+    std::vector<gen_module const *> targets(1, &modules[m]);
+    if ( opts.m_dol )
+      targets.push_back(&dol);
+    if ( m == 0 )
+    {
+      for ( uint32_t i = 1; i <= imports; ++i )
+        targets.push_back(&modules[i]);
+    }
+    else
+    {
+      targets.push_back(&modules[0]);
+    }
+
+    plan_relocations(modules[m], targets, m == 0 ? opts.m_relocations : opts.m_other_relocations, opts, random, relocations);
+    std::vector<uint8_t> image = build_rel(modules[m], opts.m_version, relocations);
+    written += image.size();
+    if ( !write_file(base + modules[m].m_name + ".rel", image) ||
+         (opts.m_symbols != 0 && !write_module_map(base + modules[m].m_name + ".map", modules[m], opts.m_symbols)) )
+    {
+      fprintf(stderr, "Failed to write %s\n", modules[m].m_name.c_str());
+      return 1;
+    }
+  }
+
+  fprintf(stderr, "Wrote %u modules (%llu bytes) to %s\n", total, static_cast<unsigned long long>(written), dir);
+  return 0;
+}